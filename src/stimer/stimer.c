@@ -24,419 +24,1765 @@
 #include <stdlib.h>
 
 #include "stimer.h"
-#include "timermath/timermath.h"
+#include "stimer_private.h"
 
-// -------------------------------------------------------------- Private types
+// ---------------------------------------------------------- Private functions
+
+// ------------ Time duration functions
+
+static void
+init_tick_rate(struct tick_rate * rate, uint32_t unit_ns, uint32_t ns_per_count)
+{
+    rate->whole = unit_ns / ns_per_count;
+    rate->fraction = (uint32_t)
+        (((uint64_t) (unit_ns % ns_per_count) << 32) / ns_per_count);
+    rate->unit_ns = unit_ns;
+}
+
+
+static inline uint64_t
+estimate_ticks(const struct tick_rate * rate, uint32_t count)
+{
+    // Never more than the exact value, and at most 2 ticks short of it
+    return ((uint64_t) count * rate->whole)
+           + (((uint64_t) count * rate->fraction) >> 32);
+}
+
+
+static inline uint64_t
+round_up_to_ticks(struct stimer_ctx * ctx,
+                  uint64_t ns,
+                  uint64_t ticks_estimate,
+                  uint32_t * excess_ns)
+{
+    // Correct the estimate to ceil(ns / ns_per_count). Only multiplies, and
+    // a handful of iterations at most
+    uint64_t ns_per_count = ctx->ns_per_count;
+    uint64_t ticks = ticks_estimate;
+
+    while ((ticks * ns_per_count) < ns) {
+        ++ticks;
+    }
+    while ((ticks > 0) && (((ticks - 1) * ns_per_count) >= ns)) {
+        --ticks;
+    }
+
+    *excess_ns = (uint32_t) ((ticks * ns_per_count) - ns);
+    return ticks;
+}
+
+
+static inline uint64_t
+duration_to_ticks(struct stimer_ctx * ctx,
+                  struct stimer_duration * t,
+                  uint32_t * excess_ns)
+{
+    uint64_t ns = ((uint64_t) t->seconds * 1000000000u) + t->nanoseconds;
+    uint64_t ticks_estimate = estimate_ticks(&ctx->ticks_per_s, t->seconds)
+        + estimate_ticks(&ctx->ticks_per_ns, t->nanoseconds);
+
+    return round_up_to_ticks(ctx, ns, ticks_estimate, excess_ns);
+}
+
+
+static inline uint64_t
+units_to_ticks(struct stimer_ctx * ctx,
+               const struct tick_rate * rate,
+               uint32_t count,
+               uint32_t * excess_ns)
+{
+    return round_up_to_ticks(ctx,
+                             (uint64_t) count * rate->unit_ns,
+                             estimate_ticks(rate, count),
+                             excess_ns);
+}
+
+
+static inline void
+ns_to_duration(uint64_t ns, struct stimer_duration * td)
+{
+    td->seconds = (uint32_t) (ns / 1000000000u);
+    td->nanoseconds = (uint32_t) (ns % 1000000000u);
+}
+
+
+// -------------------- Timer functions
+
+static void
+link_timer(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    ts->ctx = ctx;
+    ts->location = STIMER_IN_LIST;
+
+    ts->prev = NULL;
+    ts->next = ctx->root;
+    if (NULL != ctx->root) {
+        ctx->root->prev = ts;
+    }
+
+    ctx->root = ts;
+}
+
+
+static inline struct stimer_class *
+get_timer_class(struct stimer * ts)
+{
+#if STIMER_CONFIG_CLASSES
+    return ts->cls;
+#else
+    (void) ts;
+    return NULL;
+#endif
+}
+
+
+#if STIMER_CONFIG_CLASSES
+static void
+queue_timer(struct stimer_class * cls, struct stimer * ts)
+{
+    // Timers are nearly always armed from now, so they almost always go on
+    // the tail. Stepping back is only needed after stimer_advance or a kick
+    uint64_t deadline = get_expire_deadline(ts);
+    struct stimer * prev = cls->tail;
+    while ((NULL != prev) && (get_expire_deadline(prev) > deadline)) {
+        prev = prev->prev;
+    }
+
+    ts->location = STIMER_IN_CLASS;
+    ts->prev = prev;
+    if (NULL == prev) {
+        ts->next = cls->head;
+        cls->head = ts;
+    } else {
+        ts->next = prev->next;
+        prev->next = ts;
+    }
+
+    if (NULL == ts->next) {
+        cls->tail = ts;
+    } else {
+        ts->next->prev = ts;
+    }
+}
+#endif
+
+
+static void
+detach_timer(struct stimer * ts)
+{
+    struct stimer_ctx * ctx = ts->ctx;
+
+    if (STIMER_IN_INDEX == ts->location) {
+#if STIMER_HAS_INDEX
+        stimer_index_remove(ctx, ts);
+#endif
+#if STIMER_CONFIG_CLASSES
+    } else if (STIMER_IN_CLASS == ts->location) {
+        struct stimer_class * cls = ts->cls;
+        if (NULL == ts->prev) {
+            cls->head = ts->next;
+        } else {
+            ts->prev->next = ts->next;
+        }
+        if (NULL == ts->next) {
+            cls->tail = ts->prev;
+        } else {
+            ts->next->prev = ts->prev;
+        }
+#endif
+    } else {
+        if (ctx->cursor == ts) {
+            ctx->cursor = ts->next;
+        }
+
+        if (NULL == ts->prev) {
+            ctx->root = ts->next;
+        } else {
+            ts->prev->next = ts->next;
+        }
+        if (NULL != ts->next) {
+            ts->next->prev = ts->prev;
+        }
+    }
+
+    ts->next = NULL;
+    ts->prev = NULL;
+    ts->location = STIMER_IN_LIST;
+}
+
+
+static void
+unlink_timer(struct stimer * ts)
+{
+    if (NULL != ts->ctx) {
+        detach_timer(ts);
+    }
+    ts->ctx = NULL;
+}
+
+
+static void
+place_timer(struct stimer * ts)
+{
+    // Called whenever the expiration moves, so the next one is due again and
+    // gets reported
+    ts->is_expire_seen = false;
+#if STIMER_CONFIG_EXPIRE_CALLBACK
+    ts->is_expire_reported = false;
+#endif
+
+    // Pending timers of an interval class live in its queue, other pending
+    // timers in the index, and everything else in the context timer list
+    enum stimer_location location = STIMER_IN_LIST;
+    if (ts->is_running && ts->is_expiring) {
+        if (NULL != get_timer_class(ts)) {
+            location = STIMER_IN_CLASS;
+        } else if (STIMER_HAS_INDEX) {
+            location = STIMER_IN_INDEX;
+        }
+    }
+
+    if ((STIMER_IN_INDEX == location) && (STIMER_IN_INDEX == ts->location)) {
+#if STIMER_HAS_INDEX
+        stimer_index_update(ts->ctx, ts);
+#endif
+    } else if ((STIMER_IN_LIST != location)
+               || (STIMER_IN_LIST != ts->location)) {
+        detach_timer(ts);
+        if (STIMER_IN_CLASS == location) {
+#if STIMER_CONFIG_CLASSES
+            queue_timer(ts->cls, ts);
+#endif
+        } else if (STIMER_IN_INDEX == location) {
+#if STIMER_HAS_INDEX
+            ts->location = STIMER_IN_INDEX;
+            stimer_index_insert(ts->ctx, ts);
+#endif
+        } else {
+            link_timer(ts->ctx, ts);
+        }
+    }
+}
+
+
+static void
+leave_class(struct stimer * ts)
+{
+#if STIMER_CONFIG_CLASSES
+    if (STIMER_IN_CLASS == ts->location) {
+        detach_timer(ts);
+        link_timer(ts->ctx, ts);
+    }
+    ts->cls = NULL;
+#else
+    (void) ts;
+#endif
+}
+
+
+static inline uint32_t
+read_time(struct stimer_ctx * ctx)
+{
+    uint32_t now = ctx->get_time_fn(ctx->hint);
+
+    // A negative difference means the rollover requirement was not met, and
+    // that time is lost. Resync anyway, so the context clock can't get stuck
+    int32_t diff = tm_get_diff(&ctx->tm, now, ctx->now_time);
+    if (diff > 0) {
+        ctx->now_ticks += (uint32_t) diff;
+    }
+    ctx->now_time = now;
+
+    return now;
+}
+
+
+static inline void
+reset_kick(struct stimer * ts, uint64_t ticks)
+{
+#if STIMER_CONFIG_KICK
+    ts->kick_ticks = ticks;
+#else
+    (void) ts;
+    (void) ticks;
+#endif
+}
+
+
+static inline void
+reposition_kicked_timer(struct stimer * ts)
+{
+#if STIMER_CONFIG_KICK
+    // A kicked timer keeps its old expiration until it is reached, and only
+    // then is moved to expire one interval after the last kick
+    uint64_t since_kick = ts->ctx->now_ticks - ts->kick_ticks;
+    if (since_kick < ts->elapsed_ticks) {
+        ts->start_ticks = ts->kick_ticks;
+        ts->elapsed_ticks = since_kick;
+        ts->elapsed_excess_ns = 0;
+        ts->expire_ticks = ts->interval_ticks;
+        place_timer(ts);
+    }
+#else
+    (void) ts;
+#endif
+}
+
+
+static inline void
+checkpoint_timer(struct stimer * ts)
+{
+    if (ts->is_running) {
+        ts->elapsed_ticks = ts->ctx->now_ticks - ts->start_ticks;
+
+        if (ts->is_expiring && (ts->elapsed_ticks >= ts->expire_ticks)) {
+            reposition_kicked_timer(ts);
+        }
+    }
+}
+
+
+static inline void
+checkpoint_timer_2(struct stimer * ts)
+{
+    if (ts->is_running) {
+        (void) read_time(ts->ctx);
+        checkpoint_timer(ts);
+    }
+}
+
+
+static inline uint64_t
+get_remaining_ticks(struct stimer * ts)
+{
+    uint64_t ticks = 0;
+    if (ts->elapsed_ticks < ts->expire_ticks) {
+        ticks = ts->expire_ticks - ts->elapsed_ticks;
+    }
+    return ticks;
+}
+
+
+static inline uint64_t
+get_remaining_ns(struct stimer * ts)
+{
+    // interval_ns - elapsed_ns, which can't go negative while the timer has
+    // not expired
+    uint64_t ns = 0;
+    if (ts->elapsed_ticks < ts->expire_ticks) {
+        ns = ((ts->interval_ticks - ts->elapsed_ticks) * ts->ctx->ns_per_count)
+            - ts->interval_excess_ns - ts->elapsed_excess_ns;
+    }
+    return ns;
+}
+
+
+static inline uint64_t
+get_elapsed_ns(struct stimer * ts)
+{
+    return (ts->elapsed_ticks * ts->ctx->ns_per_count) + ts->elapsed_excess_ns;
+}
+
+
+static inline uint32_t
+get_ticks_until_expired(struct stimer * ts)
+{
+    // Anything past the alarm horizon is clamped by the caller, so the
+    // remaining time only needs to be exact up to 32 bits of ticks
+    uint64_t deadline = get_expire_deadline(ts);
+    uint64_t ticks = 0;
+    if (deadline > ts->ctx->now_ticks) {
+        ticks = deadline - ts->ctx->now_ticks;
+    }
+    return (ticks > UINT32_MAX) ? UINT32_MAX : (uint32_t) ticks;
+}
+
+
+static inline bool
+is_timer_alarm_pending(struct stimer * ts)
+{
+    // An expiration is due until an execute pass has seen it, even once its
+    // deadline has passed
+    return ts->is_running && ts->is_expiring && !ts->is_expire_seen;
+}
+
+
+static inline void
+mark_expiration_seen(struct stimer * ts)
+{
+    if (ts->is_running && ts->is_expiring
+        && (ts->elapsed_ticks >= ts->expire_ticks)) {
+        ts->is_expire_seen = true;
+    }
+}
+
+
+static inline uint32_t
+add_time(struct stimer_ctx * ctx, uint32_t t, uint32_t ticks)
+{
+    uint64_t sum = (uint64_t) t + ticks;
+    if (sum > ctx->max_time) {
+        sum -= (uint64_t) ctx->max_time + 1;
+    }
+    return (uint32_t) sum;
+}
+
+
+static inline void
+program_alarm(struct stimer_ctx * ctx, uint32_t ticks)
+{
+    if (ticks > ctx->alarm_horizon) {
+        ticks = ctx->alarm_horizon;
+    }
+
+    // The callback may write a hardware compare register, so it is only
+    // called when the alarm actually moves
+    uint32_t alarm_time = add_time(ctx, ctx->now_time, ticks);
+    if (!ctx->is_alarm_set || (alarm_time != ctx->alarm_time)) {
+        ctx->alarm_time = alarm_time;
+        ctx->is_alarm_set = true;
+        ctx->set_alarm_fn(ctx->alarm_hint, alarm_time);
+    }
+}
+
+
+static inline void
+fold_pass_alarm(struct stimer_ctx * ctx, uint32_t ticks)
+{
+    if (ticks > ctx->alarm_horizon) {
+        ticks = ctx->alarm_horizon;
+    }
+
+    uint32_t expire_time = add_time(ctx, ctx->now_time, ticks);
+    if (tm_get_diff(&ctx->tm, expire_time, ctx->pass_alarm_time) < 0) {
+        ctx->pass_alarm_time = expire_time;
+    }
+}
+
+
+static inline void
+update_alarm_for_timer(struct stimer * ts)
+{
+    struct stimer_ctx * ctx = ts->ctx;
+    if ((NULL != ctx->set_alarm_fn) && is_timer_alarm_pending(ts)) {
+        uint32_t now = ctx->now_time;
+        uint32_t ticks = get_ticks_until_expired(ts);
+
+        // Fold into the pass in progress, in case this timer was already
+        // visited by it
+        fold_pass_alarm(ctx, ticks);
+
+        // Only pull the alarm in. Moving it out is deferred to the end of
+        // the execute pass, which sees every timer
+        int32_t alarm_ticks = tm_get_diff(&ctx->tm, ctx->alarm_time, now);
+        if ((alarm_ticks > 0) && (ticks < (uint32_t) alarm_ticks)) {
+            program_alarm(ctx, ticks);
+        }
+    }
+}
+
+
+static void
+report_expiration(struct stimer * ts)
+{
+#if STIMER_CONFIG_EXPIRE_CALLBACK
+    // Last thing done with a timer in a pass, since the callback may free it
+    if ((NULL != ts->expire_fn) && !ts->is_expire_reported && ts->is_running
+        && ts->is_expiring && (ts->elapsed_ticks >= ts->expire_ticks)) {
+        ts->is_expire_reported = true;
+        ts->expire_fn(ts->expire_hint, ts);
+    }
+#else
+    (void) ts;
+#endif
+}
+
+
+static bool
+execute_classes(struct stimer_ctx * ctx, uint32_t * max_timers)
+{
+    // Only the head of each queue can have expired. Expired timers move to
+    // the context timer list, unless a kick moves them back into the queue
+    bool is_done = true;
+#if STIMER_CONFIG_CLASSES
+    struct stimer_class * cls;
+    for (cls = ctx->classes; NULL != cls; cls = cls->next) {
+        while (NULL != cls->head) {
+            struct stimer * ts = cls->head;
+            checkpoint_timer(ts);
+            if (ts->elapsed_ticks < ts->expire_ticks) {
+                break;
+            }
+
+            if (0 == *max_timers) {
+                is_done = false;
+                break;
+            }
+
+            detach_timer(ts);
+            link_timer(ctx, ts);
+            mark_expiration_seen(ts);
+            --(*max_timers);
+            report_expiration(ts);
+        }
+
+        if (NULL != cls->head) {
+            update_alarm_for_timer(cls->head);
+        }
+    }
+#else
+    (void) ctx;
+    (void) max_timers;
+#endif
+
+    return is_done;
+}
+
+
+#if STIMER_HAS_INDEX
+static bool
+execute_index(struct stimer_ctx * ctx, uint32_t * max_timers)
+{
+    // Expired timers move to the context timer list, unless a kick moves them
+    // back into the index
+    while (*max_timers > 0) {
+        struct stimer * ts = stimer_index_pop_expired(ctx, ctx->now_ticks);
+        if (NULL == ts) {
+            break;
+        }
+
+        ts->location = STIMER_IN_LIST;
+        link_timer(ctx, ts);
+        checkpoint_timer(ts);
+        mark_expiration_seen(ts);
+        --(*max_timers);
+        report_expiration(ts);
+    }
+
+    uint64_t next = stimer_index_next(ctx);
+    if (UINT64_MAX != next) {
+        uint64_t ticks = (next > ctx->now_ticks) ? (next - ctx->now_ticks) : 0;
+        fold_pass_alarm(ctx, (ticks > UINT32_MAX) ? UINT32_MAX : (uint32_t) ticks);
+    }
+
+    return (next > ctx->now_ticks);
+}
+#else
+static bool
+execute_list(struct stimer_ctx * ctx, uint32_t * max_timers)
+{
+    while ((NULL != ctx->cursor) && (*max_timers > 0)) {
+        struct stimer * ts = ctx->cursor;
+        ctx->cursor = ts->next;
+
+        checkpoint_timer(ts);
+        mark_expiration_seen(ts);
+        update_alarm_for_timer(ts);
+        --(*max_timers);
+        report_expiration(ts);
+    }
+
+    return (NULL == ctx->cursor);
+}
+#endif
+
+
+static bool
+execute_timers(struct stimer_ctx * ctx, uint32_t max_timers)
+{
+    (void) read_time(ctx);
+
+#if STIMER_HAS_INDEX
+    ctx->pass_alarm_time = add_time(ctx, ctx->now_time, ctx->alarm_horizon);
+#else
+    if (NULL == ctx->cursor) {
+        ctx->cursor = ctx->root;
+        ctx->pass_alarm_time = add_time(ctx, ctx->now_time, ctx->alarm_horizon);
+    }
+#endif
+
+    bool is_classes_done = execute_classes(ctx, &max_timers);
+
+#if STIMER_HAS_INDEX
+    bool is_pass_done = execute_index(ctx, &max_timers) && is_classes_done;
+#else
+    bool is_pass_done = execute_list(ctx, &max_timers) && is_classes_done;
+#endif
+
+    if (is_pass_done && (NULL != ctx->set_alarm_fn)) {
+        int32_t ticks = tm_get_diff(&ctx->tm, ctx->pass_alarm_time, ctx->now_time);
+        program_alarm(ctx, (ticks > 0) ? (uint32_t) ticks : 0);
+    }
+
+    return is_pass_done;
+}
+
+
+static inline void
+start_and_checkpoint_timer(struct stimer * ts)
+{
+    (void) read_time(ts->ctx);
+    ts->start_ticks = ts->ctx->now_ticks;
+    reset_kick(ts, ts->ctx->now_ticks);
+    ts->is_running = true;
+
+    ts->elapsed_ticks = 0;
+    ts->elapsed_excess_ns = 0;
+    ts->expire_ticks = ts->interval_ticks;
+}
+
+
+static inline void
+timer_subtract_from_elapsed(struct stimer * ts)
+{
+    // Same as subtracting the exact interval in nanoseconds. The elapsed
+    // remainder absorbs the rounding, and gives back a tick when it adds up
+    uint32_t headroom = ts->ctx->ns_per_count - ts->interval_excess_ns;
+
+    if (ts->elapsed_ticks >= ts->expire_ticks) {
+        uint64_t ticks = ts->interval_ticks;
+        if (ts->elapsed_excess_ns >= headroom) {
+            ts->elapsed_excess_ns -= headroom;
+            ticks -= 1;
+        } else {
+            ts->elapsed_excess_ns += ts->interval_excess_ns;
+        }
+        ts->elapsed_ticks -= ticks;
+        ts->start_ticks += ticks;
+    } else {
+        ts->elapsed_ticks = 0;
+        ts->elapsed_excess_ns = 0;
+        ts->start_ticks = ts->ctx->now_ticks;
+    }
+
+    ts->expire_ticks = ts->interval_ticks;
+    if (ts->elapsed_excess_ns >= headroom) {
+        ts->expire_ticks -= 1;
+    }
+}
+
+
+static inline void
+arm_timer(struct stimer * ts,
+          struct stimer_class * cls,
+          uint64_t ticks,
+          uint32_t excess_ns)
+{
+#if STIMER_CONFIG_CLASSES
+    if (ts->cls != cls) {
+        leave_class(ts);
+        ts->cls = cls;
+    }
+#else
+    (void) cls;
+#endif
+    ts->interval_ticks = ticks;
+    ts->interval_excess_ns = excess_ns;
+    start_and_checkpoint_timer(ts);
+
+    ts->is_expiring = true;
+    place_timer(ts);
+    update_alarm_for_timer(ts);
+}
+
+
+static inline void
+arm_timer_units(struct stimer * ts, const struct tick_rate * rate, uint32_t count)
+{
+    uint32_t excess_ns;
+    uint64_t ticks = units_to_ticks(ts->ctx, rate, count, &excess_ns);
+    arm_timer(ts, NULL, ticks, excess_ns);
+}
+
+
+#if STIMER_CONFIG_CLASSES
+static void
+release_class_timers(struct stimer_class * cls, struct stimer * ts)
+{
+    for (; NULL != ts; ts = ts->next) {
+        if (ts->cls == cls) {
+            ts->cls = NULL;
+        }
+    }
+}
+#endif
+
+
+// -------------------- Statistics functions
+
+// Largest tick count that still fits in Q8
+#define STATS_Q8_MAX                    (UINT64_MAX >> 8)
+
+
+static inline uint64_t
+stats_mean_q8(const struct stimer_stats * stats)
+{
+    // Running mean in 1/256 ticks, total_ticks must not exceed STATS_Q8_MAX
+    return (0 != stats->count) ? ((stats->total_ticks << 8) / stats->count) : 0u;
+}
+
+
+static void
+stats_add_deviation(struct stimer_stats * stats, uint64_t d_q8, uint64_t next_d_q8,
+                    bool is_subtract)
+{
+    // Adds or subtracts the product of two Q8 deviations to the sum of
+    // squared deviations, kept in whole ticks squared and a Q16 fraction.
+    // Deviations too large for a Q16 product lose their fraction instead
+    uint64_t ticks;
+    uint32_t fraction = 0;
+    if ((d_q8 <= UINT32_MAX) && (next_d_q8 <= UINT32_MAX)) {
+        uint64_t product = d_q8 * next_d_q8;
+        ticks = product >> 16;
+        fraction = (uint32_t) (product & 0xFFFFu);
+    } else {
+        uint64_t d = d_q8 >> 8;
+        uint64_t next_d = next_d_q8 >> 8;
+        if ((0 != d) && (next_d > (UINT64_MAX / d))) {
+            stats->is_saturated = true;
+            return;
+        }
+        ticks = d * next_d;
+    }
+
+    if (is_subtract) {
+        // Borrow a tick for the fraction, which wraps around below
+        if (fraction > stats->squared_deviation_fraction) {
+            ticks += 1;
+        }
+        if (ticks > stats->squared_deviation_ticks) {
+            stats->squared_deviation_ticks = 0;
+            stats->squared_deviation_fraction = 0;
+        } else {
+            stats->squared_deviation_ticks -= ticks;
+            stats->squared_deviation_fraction =
+                (uint16_t) (stats->squared_deviation_fraction - fraction);
+        }
+    } else {
+        fraction += stats->squared_deviation_fraction;
+        ticks += fraction >> 16;
+        if (ticks > (UINT64_MAX - stats->squared_deviation_ticks)) {
+            stats->is_saturated = true;
+        } else {
+            stats->squared_deviation_ticks += ticks;
+            stats->squared_deviation_fraction = (uint16_t) (fraction & 0xFFFFu);
+        }
+    }
+}
+
+
+// ----------------------------------------------------------- Public functions
+
+// ---------------------- Timer context
+
+struct stimer_ctx *
+stimer_alloc_context(void * hint,
+                     stimer_get_time_fn get_time_fn,
+                     uint32_t max_time,
+                     uint32_t ns_per_count)
+{
+    struct stimer_ctx * ctx = NULL;
+    if ((NULL != get_time_fn) && (0 != ns_per_count)) {
+        ctx = (struct stimer_ctx *) malloc(sizeof(struct stimer_ctx));
+    }
+
+    if (NULL != ctx) {
+        ctx->root = NULL;
+        ctx->cursor = NULL;
+#if STIMER_CONFIG_CLASSES
+        ctx->classes = NULL;
+#endif
+
+        tm_initialize(&ctx->tm, max_time);
+
+        ctx->ns_per_count = ns_per_count;
+        init_tick_rate(&ctx->ticks_per_s, 1000000000u, ns_per_count);
+        init_tick_rate(&ctx->ticks_per_ms, 1000000u, ns_per_count);
+        init_tick_rate(&ctx->ticks_per_us, 1000u, ns_per_count);
+        init_tick_rate(&ctx->ticks_per_ns, 1u, ns_per_count);
+
+        ctx->get_time_fn = get_time_fn;
+        ctx->hint = hint;
+
+        ctx->now_time = get_time_fn(hint);
+        ctx->now_ticks = 0;
+
+        ctx->set_alarm_fn = NULL;
+        ctx->alarm_hint = NULL;
+        ctx->alarm_time = 0;
+        ctx->is_alarm_set = false;
+        ctx->alarm_horizon = (max_time / 4u > 0) ? (max_time / 4u) : 1u;
+        ctx->max_time = max_time;
+        ctx->pass_alarm_time = 0;
+
+#if STIMER_HAS_INDEX
+        if (!stimer_index_init(ctx)) {
+            free(ctx);
+            ctx = NULL;
+        }
+#endif
+    }
+
+    return ctx;
+}
+
+
+void
+stimer_free_context(struct stimer_ctx * ctx)
+{
+    if (NULL != ctx) {
+#if STIMER_CONFIG_CLASSES
+        while (NULL != ctx->classes) {
+            struct stimer_class * cls = ctx->classes;
+            while (NULL != cls->head) {
+                struct stimer * ts = cls->head;
+                unlink_timer(ts);
+                ts->cls = NULL;
+            }
+            release_class_timers(cls, ctx->root);
+
+            ctx->classes = cls->next;
+            cls->next = NULL;
+            cls->ctx = NULL;
+        }
+#endif
+
+#if STIMER_HAS_INDEX
+        struct stimer * ts;
+        while (NULL != (ts = stimer_index_first(ctx))) {
+            unlink_timer(ts);
+        }
+        stimer_index_deinit(ctx);
+#endif
+
+        while (NULL != ctx->root) {
+            unlink_timer(ctx->root);
+        }
+
+        free(ctx);
+    }
+}
+
+
+void
+stimer_execute_context(struct stimer_ctx * ctx)
+{
+    if (NULL != ctx) {
+        // Always a full pass, abandoning any budgeted pass in progress
+        ctx->cursor = NULL;
+        (void) execute_timers(ctx, UINT32_MAX);
+    }
+}
+
+
+bool
+stimer_execute_context_budget(struct stimer_ctx * ctx, uint32_t max_timers)
+{
+    bool is_pass_done = true;
+    if (NULL != ctx) {
+        is_pass_done = execute_timers(ctx, max_timers);
+    }
+    return is_pass_done;
+}
+
+
+void
+stimer_set_alarm_callback(struct stimer_ctx * ctx,
+                          void * hint,
+                          stimer_set_alarm_fn set_alarm_fn)
+{
+    if (NULL != ctx) {
+        ctx->set_alarm_fn = set_alarm_fn;
+        ctx->alarm_hint = hint;
+        ctx->is_alarm_set = false;
+
+        if (NULL != set_alarm_fn) {
+            stimer_execute_context(ctx);
+        }
+    }
+}
+
+
+uint32_t
+stimer_get_ticks_until_next(struct stimer_ctx * ctx)
+{
+    uint32_t ticks = 0;
+    if (NULL != ctx) {
+        (void) read_time(ctx);
+        ticks = ctx->alarm_horizon;
+
+#if STIMER_CONFIG_CLASSES
+        struct stimer_class * cls;
+        for (cls = ctx->classes; NULL != cls; cls = cls->next) {
+            if ((NULL != cls->head) && is_timer_alarm_pending(cls->head)) {
+                uint32_t cls_ticks = get_ticks_until_expired(cls->head);
+                ticks = (cls_ticks < ticks) ? cls_ticks : ticks;
+            }
+        }
+#endif
+
+#if STIMER_HAS_INDEX
+        // A bound at or before now means an execute pass is due, either to
+        // collect expired timers or to move the index forward
+        uint64_t next = stimer_index_next(ctx);
+        if (next <= ctx->now_ticks) {
+            ticks = 0;
+        } else if ((next - ctx->now_ticks) < ticks) {
+            ticks = (uint32_t) (next - ctx->now_ticks);
+        }
+#else
+        struct stimer * ts;
+        for (ts = ctx->root; NULL != ts; ts = ts->next) {
+            if (is_timer_alarm_pending(ts)) {
+                uint32_t ts_ticks = get_ticks_until_expired(ts);
+                ticks = (ts_ticks < ticks) ? ts_ticks : ticks;
+            }
+        }
+#endif
+    }
+    return ticks;
+}
+
+
+// ---------------------- Context clock
+
+uint64_t
+stimer_get_context_ticks(struct stimer_ctx * ctx)
+{
+    uint64_t ticks = 0;
+    if (NULL != ctx) {
+        (void) read_time(ctx);
+        ticks = ctx->now_ticks;
+    }
+    return ticks;
+}
+
+
+uint64_t
+stimer_duration_to_ticks(struct stimer_ctx * ctx, struct stimer_duration * t)
+{
+    uint64_t ticks = 0;
+    if ((NULL != ctx) && (NULL != t)) {
+        uint32_t excess_ns;
+        ticks = duration_to_ticks(ctx, t, &excess_ns);
+    }
+    return ticks;
+}
+
+
+uint64_t
+stimer_ms_to_ticks(struct stimer_ctx * ctx, uint32_t ms)
+{
+    uint64_t ticks = 0;
+    if (NULL != ctx) {
+        uint32_t excess_ns;
+        ticks = units_to_ticks(ctx, &ctx->ticks_per_ms, ms, &excess_ns);
+    }
+    return ticks;
+}
+
+
+uint64_t
+stimer_us_to_ticks(struct stimer_ctx * ctx, uint32_t us)
+{
+    uint64_t ticks = 0;
+    if (NULL != ctx) {
+        uint32_t excess_ns;
+        ticks = units_to_ticks(ctx, &ctx->ticks_per_us, us, &excess_ns);
+    }
+    return ticks;
+}
+
+
+uint64_t
+stimer_ms_to_ticks_carry(struct stimer_ctx * ctx, uint32_t ms, uint32_t * excess_ns)
+{
+    uint64_t ticks = 0;
+    if ((NULL != ctx) && (NULL != excess_ns)) {
+        // The previous rounding already covers the start of the interval
+        uint64_t ns = (uint64_t) ms * ctx->ticks_per_ms.unit_ns;
+        if (ns <= *excess_ns) {
+            *excess_ns -= (uint32_t) ns;
+        } else {
+            ticks = round_up_to_ticks(ctx,
+                                      ns - *excess_ns,
+                                      estimate_ticks(&ctx->ticks_per_ms, ms),
+                                      excess_ns);
+        }
+    }
+    return ticks;
+}
+
+
+void
+stimer_ticks_to_duration(struct stimer_ctx * ctx,
+                         uint64_t ticks,
+                         struct stimer_duration * t)
+{
+    if ((NULL != ctx) && (NULL != t)) {
+        ns_to_duration(ticks * ctx->ns_per_count, t);
+    }
+}
+
+
+// ---------------------- Interval class
+
+struct stimer_class *
+stimer_alloc_class(struct stimer_ctx * ctx, struct stimer_duration * t)
+{
+    struct stimer_class * cls = NULL;
+
+#if STIMER_CONFIG_CLASSES
+    if ((NULL != ctx) && (NULL != t)) {
+        cls = (struct stimer_class *) malloc(sizeof(struct stimer_class));
+        if (NULL != cls) {
+            cls->ctx = ctx;
+            cls->head = NULL;
+            cls->tail = NULL;
+
+            cls->interval_ticks =
+                duration_to_ticks(ctx, t, &cls->interval_excess_ns);
+
+            cls->next = ctx->classes;
+            ctx->classes = cls;
+        }
+    }
+#else
+    (void) ctx;
+    (void) t;
+#endif
+
+    return cls;
+}
+
+
+void
+stimer_free_class(struct stimer_class * cls)
+{
+#if STIMER_CONFIG_CLASSES
+    if (NULL != cls) {
+        struct stimer_ctx * ctx = cls->ctx;
+        if (NULL != ctx) {
+            // Queued timers carry on as ordinary timers
+            while (NULL != cls->head) {
+                leave_class(cls->head);
+            }
+            release_class_timers(cls, ctx->root);
+
+            struct stimer_class ** link = &ctx->classes;
+            while (*link != cls) {
+                link = &(*link)->next;
+            }
+            *link = cls->next;
+        }
+
+        free(cls);
+    }
+#else
+    (void) cls;
+#endif
+}
+
+
+// ------------------------------ Timer
+
+struct stimer *
+stimer_alloc(struct stimer_ctx * ctx)
+{
+    struct stimer * ts = NULL;
+
+    if (NULL != ctx) {
+        ts = (struct stimer *) malloc(sizeof(struct stimer));
+        if (NULL != ts) {
+            ts->ctx = NULL;
+            ts->next = NULL;
+            ts->prev = NULL;
+#if STIMER_CONFIG_CLASSES
+            ts->cls = NULL;
+#endif
+            ts->location = STIMER_IN_LIST;
+
+            ts->start_ticks = 0;
+
+            ts->interval_ticks = 0;
+            ts->interval_excess_ns = 0;
+            ts->expire_ticks = 0;
+
+            ts->elapsed_ticks = 0;
+            ts->elapsed_excess_ns = 0;
+            ts->is_running = false;
+            ts->is_expiring = false;
+            ts->is_expire_seen = false;
+
+#if STIMER_CONFIG_KICK
+            ts->kick_ticks = 0;
+#endif
+
+#if STIMER_CONFIG_EXPIRE_CALLBACK
+            ts->expire_fn = NULL;
+            ts->expire_hint = NULL;
+            ts->is_expire_reported = false;
+#endif
+#if STIMER_CONFIG_STATS
+            ts->stats = NULL;
+            ts->is_jitter_stats = false;
+#endif
+
+            link_timer(ctx, ts);
+        }
+    }
+
+    return ts;
+}
+
+
+void
+stimer_free(struct stimer * ts)
+{
+    if (NULL != ts) {
+        unlink_timer(ts);
+        free(ts);
+    }
+}
+
+
+// ------------ Elapsed timer functions
+
+void
+stimer_start(struct stimer * ts)
+{
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        leave_class(ts);
+        start_and_checkpoint_timer(ts);
+        ts->is_expiring = false;
+        place_timer(ts);
+    }
+}
+
+
+void
+stimer_stop(struct stimer * ts)
+{
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        if (ts->is_running) {
+            checkpoint_timer_2(ts);
+            ts->is_running = false;
+            place_timer(ts);
+#if STIMER_CONFIG_STATS
+            if (!ts->is_jitter_stats) {
+                stimer_stats_add(ts->stats, ts->elapsed_ticks);
+            }
+#endif
+        }
+    }
+}
 
-struct stimer {
-    // Context
-    struct stimer_ctx *                 ctx;
 
+void
+stimer_get_elapsed_time(struct stimer * ts, struct stimer_duration * t)
+{
+    if ((NULL != ts) && (NULL != t)) {
+        if (NULL != ts->ctx) {
+            checkpoint_timer_2(ts);
+            ns_to_duration(get_elapsed_ns(ts), t);
+        } else {
+            t->seconds = 0;
+            t->nanoseconds = 0;
+        }
+    }
+}
 
-    // Linked list
-    struct stimer *                     next;
 
+uint64_t
+stimer_get_elapsed_ticks(struct stimer * ts)
+{
+    uint64_t ticks = 0;
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        checkpoint_timer_2(ts);
+        ticks = ts->elapsed_ticks;
+    }
+    return ticks;
+}
 
-    // Last get_time_fn checkpoint
-    uint32_t                            checkpoint;
 
+uint64_t
+stimer_get_elapsed_ns64(struct stimer * ts)
+{
+    uint64_t ns = 0;
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        checkpoint_timer_2(ts);
+        ns = get_elapsed_ns(ts);
+    }
+    return ns;
+}
 
-    // Expire period
-    struct stimer_duration              expire_interval;
 
+uint64_t
+stimer_lap(struct stimer * ts)
+{
+    uint64_t ticks = 0;
+    if ((NULL != ts) && (NULL != ts->ctx) && ts->is_running && !ts->is_expiring) {
+        checkpoint_timer_2(ts);
+        ticks = ts->elapsed_ticks;
 
-    // Elapsed time
-    struct stimer_duration              elapsed;
-    bool                                is_running;
-};
+        ts->start_ticks = ts->ctx->now_ticks;
+        reset_kick(ts, ts->ctx->now_ticks);
+        ts->elapsed_ticks = 0;
+        ts->elapsed_excess_ns = 0;
 
+#if STIMER_CONFIG_STATS
+        if (!ts->is_jitter_stats) {
+            stimer_stats_add(ts->stats, ticks);
+        }
+#endif
+    }
+    return ticks;
+}
 
-struct stimer_ctx {
-    // Timer linked list root
-    struct stimer *                     root;
 
+bool
+stimer_set_stats(struct stimer * ts, struct stimer_stats * stats)
+{
+    bool is_set = false;
+#if STIMER_CONFIG_STATS
+    if (NULL != ts) {
+        ts->stats = stats;
+        ts->is_jitter_stats = false;
+        is_set = true;
+    }
+#else
+    (void) ts;
+    (void) stats;
+#endif
+    return is_set;
+}
 
-    // Timer math
-    struct tm_math                      tm;
-    uint32_t                            ns_per_count;
 
+// ------------- Expire timer functions
 
-    // Time function
-    stimer_get_time_fn                  get_time_fn;
-    void *                              hint;
-};
+void
+stimer_expire_from_now(struct stimer * ts, struct stimer_duration * t)
+{
+    if ((NULL != ts) && (NULL != ts->ctx) && (NULL != t)) {
+        uint32_t excess_ns;
+        uint64_t ticks = duration_to_ticks(ts->ctx, t, &excess_ns);
+        arm_timer(ts, NULL, ticks, excess_ns);
+    }
+}
 
 
-// ---------------------------------------------------------- Private functions
+void
+stimer_expire_from_now_s(struct stimer * ts, uint32_t s)
+{
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        arm_timer_units(ts, &ts->ctx->ticks_per_s, s);
+    }
+}
 
-// ------------ Time duration functions
 
-static inline void
-advance_duration_ns(struct stimer_duration * td, uint32_t ns_advance)
+void
+stimer_expire_from_now_ms(struct stimer * ts, uint32_t ms)
 {
-    // Need to be really careful about overflows in here, hence strange math
-    uint32_t headroom = 1000000000u - td->nanoseconds;
-
-    if (ns_advance < headroom) {
-        td->nanoseconds += ns_advance;
-    } else {
-        td->seconds += 1;
-        td->nanoseconds = ns_advance - headroom;
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        arm_timer_units(ts, &ts->ctx->ticks_per_ms, ms);
     }
 }
 
 
-static inline bool
-is_duration_ge(struct stimer_duration * lhs, struct stimer_duration * rhs)
+void
+stimer_expire_from_now_us(struct stimer * ts, uint32_t us)
 {
-    bool is_ge = false;
-    if (lhs->seconds > rhs->seconds) {
-        is_ge = true;
-    } else if (lhs->seconds == rhs->seconds) {
-        if (lhs->nanoseconds >= rhs->nanoseconds) {
-            is_ge = true;
-        }
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        arm_timer_units(ts, &ts->ctx->ticks_per_us, us);
     }
-    return is_ge;
 }
 
 
-static inline void
-set_duration_s(struct stimer_duration * td, uint32_t s)
+void
+stimer_expire_from_now_ns(struct stimer * ts, uint32_t ns)
 {
-    td->seconds = s;
-    td->nanoseconds = 0;
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        arm_timer_units(ts, &ts->ctx->ticks_per_ns, ns);
+    }
 }
 
 
-static inline void
-set_duration_ms(struct stimer_duration * td, uint32_t ms)
+void
+stimer_expire_from_now_ticks(struct stimer * ts, uint32_t ticks)
 {
-    td->seconds = ms / 1000;
-    td->nanoseconds = (ms % 1000) * 1000000;
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        arm_timer(ts, NULL, ticks, 0);
+    }
 }
 
 
-static inline void
-set_duration_us(struct stimer_duration * td, uint32_t us)
+void
+stimer_expire_from_now_class(struct stimer * ts, struct stimer_class * cls)
 {
-    td->seconds = us / 1000000;
-    td->nanoseconds = (us % 1000000) * 1000;
+    if ((NULL != ts) && (NULL != ts->ctx) && (NULL != cls)
+        && (ts->ctx == cls->ctx)) {
+        arm_timer(ts, cls, cls->interval_ticks, cls->interval_excess_ns);
+    }
 }
 
 
-static inline void
-set_duration_ns(struct stimer_duration * td, uint32_t ns)
+bool
+stimer_is_expired(struct stimer * ts)
 {
-    td->seconds = ns / 1000000000;
-    td->nanoseconds = ns % 1000000000;
+    bool expired = false;
+    if (NULL != ts) {
+        if (NULL != ts->ctx) {
+            checkpoint_timer_2(ts);
+            expired = (ts->elapsed_ticks >= ts->expire_ticks);
+        } else {
+            /* No clock left to count against, so no time remains */
+            expired = true;
+        }
+    }
+    return expired;
 }
 
 
-// -------------------- Timer functions
-
-static void
-link_timer(struct stimer_ctx * ctx, struct stimer * ts)
+bool
+stimer_get_remaining_time(struct stimer * ts, struct stimer_duration * t)
 {
-    ts->ctx = ctx;
-
-    if (NULL == ctx->root) {
-        ts->next = NULL;
-    } else {
-        ts->next = ctx->root;
+    bool expired = false;
+    uint64_t ns = 0;
+    if (NULL != ts) {
+        if (NULL != ts->ctx) {
+            checkpoint_timer_2(ts);
+            ns = get_remaining_ns(ts);
+            expired = (ts->elapsed_ticks >= ts->expire_ticks);
+        } else {
+            expired = true;
+        }
     }
 
-    ctx->root = ts;
+    if (NULL != t) {
+        ns_to_duration(ns, t);
+    }
+    return expired;
 }
 
 
-static void
-unlink_timer(struct stimer * ts)
+void
+stimer_restart_from_now(struct stimer * ts)
 {
-    struct stimer * next = ts->next;
-    struct stimer_ctx * ctx = ts->ctx;
-    ts->next = NULL;
-    ts->ctx = NULL;
-
-    if (NULL != ctx) {
-        if (ctx->root == ts) {
-            ctx->root = next;
-        } else {
-            struct stimer * prev = NULL;
-            for (prev = ctx->root; NULL != prev; prev = prev->next) {
-                if (ts == prev->next) {
-                    prev->next = next;
-                    break;
-                }
-            }
-        }
+    if ((NULL != ts) && (NULL != ts->ctx) && (ts->is_running)) {
+        start_and_checkpoint_timer(ts);
+        place_timer(ts);
+        update_alarm_for_timer(ts);
     }
 }
 
 
-static inline void
-checkpoint_timer(struct stimer * ts, struct tm_math * tm, uint32_t now)
+void
+stimer_advance(struct stimer * ts)
 {
-    if (ts->is_running) {
-        int32_t diff = tm_get_diff(tm, now, ts->checkpoint);
-        if (diff > 0) {
-            uint32_t ns_advance = diff * ts->ctx->ns_per_count;
-            advance_duration_ns(&ts->elapsed, ns_advance);
-            ts->checkpoint = now;
+    if ((NULL != ts) && (NULL != ts->ctx) && (ts->is_running)) {
+        checkpoint_timer_2(ts);
+#if STIMER_CONFIG_STATS
+        if (ts->is_jitter_stats && (ts->elapsed_ticks >= ts->expire_ticks)) {
+            stimer_stats_add(ts->stats, ts->elapsed_ticks - ts->expire_ticks);
         }
+#endif
+        timer_subtract_from_elapsed(ts);
+        place_timer(ts);
+        update_alarm_for_timer(ts);
     }
 }
 
 
-static inline void
-checkpoint_timer_2(struct stimer * ts)
+bool
+stimer_kick(struct stimer * ts)
 {
-    if (ts->is_running) {
-        struct stimer_ctx * ctx = ts->ctx;
-        uint32_t now = ctx->get_time_fn(ctx->hint);
-        checkpoint_timer(ts, &ctx->tm, now);
+    bool is_kicked = false;
+#if STIMER_CONFIG_KICK
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        (void) read_time(ts->ctx);
+        is_kicked = stimer_kick_at(ts, ts->ctx->now_ticks);
     }
+#else
+    (void) ts;
+#endif
+    return is_kicked;
 }
 
 
-static inline void
-start_and_checkpoint_timer(struct stimer * ts)
+bool
+stimer_kick_at(struct stimer * ts, uint64_t now_ticks)
 {
-    ts->checkpoint = ts->ctx->get_time_fn(ts->ctx->hint);
-    ts->is_running = true;
+    bool is_kicked = false;
+#if STIMER_CONFIG_KICK
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        // A kick can't be later than the last clock read, or earlier than
+        // the previous kick
+        struct stimer_ctx * ctx = ts->ctx;
+        if (now_ticks > ctx->now_ticks) {
+            now_ticks = ctx->now_ticks;
+        }
+        if (now_ticks > ts->kick_ticks) {
+            ts->kick_ticks = now_ticks;
+        }
 
-    ts->elapsed.seconds = 0;
-    ts->elapsed.nanoseconds = 0;
+        // An expiration that was already reached moves right away, the same
+        // on every backend, instead of whenever the timer is next visited
+        if (ts->is_running && ts->is_expiring) {
+            checkpoint_timer(ts);
+            update_alarm_for_timer(ts);
+        }
+        is_kicked = true;
+    }
+#else
+    (void) ts;
+    (void) now_ticks;
+#endif
+    return is_kicked;
 }
 
 
-static inline void
-timer_subtract_from_elapsed(struct stimer * ts, struct stimer_duration * td)
+bool
+stimer_set_expire_callback(struct stimer * ts, void * hint, stimer_expire_fn expire_fn)
 {
-    if (is_duration_ge(&ts->elapsed, td)) {
-        ts->elapsed.seconds -= td->seconds;
-        if (ts->elapsed.nanoseconds >= td->nanoseconds) {
-            ts->elapsed.nanoseconds -= td->nanoseconds;
-        } else {
-            ts->elapsed.seconds -= 1;
-            ts->elapsed.nanoseconds += (1000000000 - td->nanoseconds);
-        }
-    } else {
-        ts->elapsed.seconds = 0;
-        ts->elapsed.nanoseconds = 0;
+    bool is_set = false;
+#if STIMER_CONFIG_EXPIRE_CALLBACK
+    if (NULL != ts) {
+        ts->expire_fn = expire_fn;
+        ts->expire_hint = hint;
+        is_set = true;
     }
+#else
+    (void) ts;
+    (void) hint;
+    (void) expire_fn;
+#endif
+    return is_set;
 }
 
 
-// ----------------------------------------------------------- Public functions
+bool
+stimer_set_jitter_stats(struct stimer * ts, struct stimer_stats * stats)
+{
+    bool is_set = false;
+#if STIMER_CONFIG_STATS
+    if (NULL != ts) {
+        ts->stats = stats;
+        ts->is_jitter_stats = true;
+        is_set = true;
+    }
+#else
+    (void) ts;
+    (void) stats;
+#endif
+    return is_set;
+}
 
-// ---------------------- Timer context
 
-struct stimer_ctx *
-stimer_alloc_context(void * hint,
-                     stimer_get_time_fn get_time_fn,
-                     uint32_t max_time,
-                     uint32_t ns_per_count)
+uint64_t
+stimer_get_remaining_ticks(struct stimer * ts)
 {
-    struct stimer_ctx * ctx = (struct stimer_ctx *) malloc(sizeof(struct stimer_ctx));
-
-    if (NULL != ctx) {
-        ctx->root = NULL;
+    uint64_t ticks = 0;
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        checkpoint_timer_2(ts);
+        ticks = get_remaining_ticks(ts);
+    }
+    return ticks;
+}
 
-        tm_initialize(&ctx->tm, max_time);
 
-        ctx->ns_per_count = ns_per_count;
-        ctx->get_time_fn = get_time_fn;
-        ctx->hint = hint;
+uint64_t
+stimer_get_remaining_ns64(struct stimer * ts)
+{
+    uint64_t ns = 0;
+    if ((NULL != ts) && (NULL != ts->ctx)) {
+        checkpoint_timer_2(ts);
+        ns = get_remaining_ns(ts);
     }
-
-    return ctx;
+    return ns;
 }
 
 
+// ---------------------- Stopwatch
+
 void
-stimer_free_context(struct stimer_ctx * ctx)
+stimer_stopwatch_start(struct stimer_stopwatch * sw, struct stimer_ctx * ctx)
 {
-    if (NULL != ctx) {
-        while (NULL != ctx->root) {
-            unlink_timer(ctx->root);
-        }
-
-        free(ctx);
+    if (NULL != sw) {
+        sw->ctx = ctx;
+        sw->start_ticks = stimer_get_context_ticks(ctx);
     }
 }
 
 
 void
-stimer_execute_context(struct stimer_ctx * ctx)
+stimer_stopwatch_get_elapsed_time(struct stimer_stopwatch * sw,
+                                  struct stimer_duration * t)
 {
-    if (NULL != ctx) {
-        uint32_t now = ctx->get_time_fn(ctx->hint);
-
-        struct stimer * ts;
-        for (ts = ctx->root; NULL != ts; ts = ts->next) {
-            checkpoint_timer(ts, &ctx->tm, now);
+    if (NULL != t) {
+        t->seconds = 0;
+        t->nanoseconds = 0;
+        if (NULL != sw) {
+            stimer_ticks_to_duration(sw->ctx, stimer_stopwatch_get_elapsed_ticks(sw), t);
         }
     }
 }
 
 
-// ------------------------------ Timer
+uint64_t
+stimer_stopwatch_get_elapsed_ticks(struct stimer_stopwatch * sw)
+{
+    uint64_t ticks = 0;
+    if ((NULL != sw) && (NULL != sw->ctx)) {
+        ticks = stimer_get_context_ticks(sw->ctx) - sw->start_ticks;
+    }
+    return ticks;
+}
 
-struct stimer *
-stimer_alloc(struct stimer_ctx * ctx)
+
+uint64_t
+stimer_stopwatch_get_elapsed_ns64(struct stimer_stopwatch * sw)
 {
-    struct stimer * ts = NULL;
+    uint64_t ns = 0;
+    if ((NULL != sw) && (NULL != sw->ctx)) {
+        ns = stimer_stopwatch_get_elapsed_ticks(sw) * sw->ctx->ns_per_count;
+    }
+    return ns;
+}
 
-    if (NULL != ctx) {
-        ts = (struct stimer *) malloc(sizeof(struct stimer));
-        if (NULL != ts) {
-            ts->ctx = NULL;
-            ts->next = NULL;
 
-            ts->checkpoint = 0;
+uint64_t
+stimer_stopwatch_lap_ticks(struct stimer_stopwatch * sw)
+{
+    uint64_t ticks = 0;
+    if ((NULL != sw) && (NULL != sw->ctx)) {
+        uint64_t now = stimer_get_context_ticks(sw->ctx);
+        ticks = now - sw->start_ticks;
+        sw->start_ticks = now;
+    }
+    return ticks;
+}
 
-            ts->expire_interval.seconds = 0;
-            ts->expire_interval.nanoseconds = 0;
 
-            ts->elapsed.seconds = 0;
-            ts->elapsed.nanoseconds = 0;
-            ts->is_running = false;
+// ---------------------- Deadline
 
-            link_timer(ctx, ts);
-        }
+void
+stimer_deadline_from_now(struct stimer_deadline * dl,
+                         struct stimer_ctx * ctx,
+                         struct stimer_duration * t)
+{
+    if ((NULL != dl) && (NULL != ctx) && (NULL != t)) {
+        dl->ctx = ctx;
+        dl->deadline_ticks = stimer_get_context_ticks(ctx)
+                           + duration_to_ticks(ctx, t, &dl->excess_ns);
     }
-
-    return ts;
 }
 
 
 void
-stimer_free(struct stimer * ts)
+stimer_deadline_from_now_ms(struct stimer_deadline * dl,
+                            struct stimer_ctx * ctx,
+                            uint32_t ms)
 {
-    if (NULL != ts) {
-        unlink_timer(ts);
-        free(ts);
+    if ((NULL != dl) && (NULL != ctx)) {
+        dl->ctx = ctx;
+        dl->deadline_ticks = stimer_get_context_ticks(ctx)
+                           + units_to_ticks(ctx, &ctx->ticks_per_ms, ms, &dl->excess_ns);
     }
 }
 
 
-// ------------ Elapsed timer functions
-
 void
-stimer_start(struct stimer * ts)
+stimer_deadline_from_now_us(struct stimer_deadline * dl,
+                            struct stimer_ctx * ctx,
+                            uint32_t us)
 {
-    if ((NULL != ts) && (NULL != ts->ctx)) {
-        start_and_checkpoint_timer(ts);
+    if ((NULL != dl) && (NULL != ctx)) {
+        dl->ctx = ctx;
+        dl->deadline_ticks = stimer_get_context_ticks(ctx)
+                           + units_to_ticks(ctx, &ctx->ticks_per_us, us, &dl->excess_ns);
     }
 }
 
 
 void
-stimer_stop(struct stimer * ts)
+stimer_deadline_advance_ms(struct stimer_deadline * dl, uint32_t ms)
 {
-    if ((NULL != ts) && (NULL != ts->ctx)) {
-        if (ts->is_running) {
-            checkpoint_timer_2(ts);
-            ts->is_running = false;
-        }
+    if ((NULL != dl) && (NULL != dl->ctx) && (UINT64_MAX != dl->deadline_ticks)) {
+        dl->deadline_ticks += stimer_ms_to_ticks_carry(dl->ctx, ms, &dl->excess_ns);
     }
 }
 
 
 void
-stimer_get_elapsed_time(struct stimer * ts, struct stimer_duration * t)
+stimer_deadline_never(struct stimer_deadline * dl, struct stimer_ctx * ctx)
 {
-    if ((NULL != ts) && (NULL != t)) {
-        if (NULL != ts->ctx) {
-            checkpoint_timer_2(ts);
-        }
-
-        *t = ts->elapsed;
+    if (NULL != dl) {
+        dl->ctx = ctx;
+        dl->deadline_ticks = UINT64_MAX;
+        dl->excess_ns = 0;
     }
 }
 
 
-// ------------- Expire timer functions
+bool
+stimer_deadline_is_expired(const struct stimer_deadline * dl)
+{
+    return (0 == stimer_deadline_get_remaining_ticks(dl));
+}
 
-void
-stimer_expire_from_now(struct stimer * ts, struct stimer_duration * t)
+
+bool
+stimer_deadline_get_remaining_time(const struct stimer_deadline * dl,
+                                   struct stimer_duration * t)
 {
-    if ((NULL != ts) && (NULL != ts->ctx) && (NULL != t)) {
-        start_and_checkpoint_timer(ts);
-        ts->expire_interval = *t;
+    uint64_t ticks = stimer_deadline_get_remaining_ticks(dl);
+    if (NULL != t) {
+        t->seconds = 0;
+        t->nanoseconds = 0;
+        if ((0 != ticks) && (UINT64_MAX != ticks)) {
+            stimer_ticks_to_duration(dl->ctx, ticks, t);
+        } else if (0 != ticks) {
+            t->seconds = UINT32_MAX;
+        }
     }
+    return (0 == ticks);
 }
 
 
-void
-stimer_expire_from_now_s(struct stimer * ts, uint32_t s)
+uint64_t
+stimer_deadline_get_remaining_ticks(const struct stimer_deadline * dl)
 {
-    if ((NULL != ts) && (NULL != ts->ctx)) {
-        start_and_checkpoint_timer(ts);
-        set_duration_s(&ts->expire_interval, s);
+    uint64_t ticks = 0;
+    if ((NULL != dl) && (NULL != dl->ctx)) {
+        if (UINT64_MAX == dl->deadline_ticks) {
+            ticks = UINT64_MAX;
+        } else {
+            uint64_t now = stimer_get_context_ticks(dl->ctx);
+            ticks = (dl->deadline_ticks > now) ? (dl->deadline_ticks - now) : 0;
+        }
     }
+    return ticks;
 }
 
 
-void
-stimer_expire_from_now_ms(struct stimer * ts, uint32_t ms)
+struct stimer_deadline
+stimer_deadline_min(struct stimer_deadline a, struct stimer_deadline b)
 {
-    if ((NULL != ts) && (NULL != ts->ctx)) {
-        start_and_checkpoint_timer(ts);
-        set_duration_ms(&ts->expire_interval, ms);
+    struct stimer_deadline dl = a;
+    if ((a.ctx == b.ctx) && (b.deadline_ticks < a.deadline_ticks)) {
+        dl = b;
     }
+    return dl;
 }
 
 
 void
-stimer_expire_from_now_us(struct stimer * ts, uint32_t us)
+stimer_deadline_limit_ms(struct stimer_deadline * dl, uint32_t ms)
 {
-    if ((NULL != ts) && (NULL != ts->ctx)) {
-        start_and_checkpoint_timer(ts);
-        set_duration_us(&ts->expire_interval, us);
+    if ((NULL != dl) && (NULL != dl->ctx)) {
+        struct stimer_deadline limit;
+        stimer_deadline_from_now_ms(&limit, dl->ctx, ms);
+        *dl = stimer_deadline_min(*dl, limit);
     }
 }
 
 
+// ---------------------- Statistics
+
 void
-stimer_expire_from_now_ns(struct stimer * ts, uint32_t ns)
+stimer_stats_reset(struct stimer_stats * stats)
 {
-    if ((NULL != ts) && (NULL != ts->ctx)) {
-        start_and_checkpoint_timer(ts);
-        set_duration_ns(&ts->expire_interval, ns);
+    if (NULL != stats) {
+        stats->count = 0;
+        stats->is_saturated = false;
+        stats->total_ticks = 0;
+        stats->squared_deviation_ticks = 0;
+        stats->squared_deviation_fraction = 0;
+        stats->min_ticks = UINT64_MAX;
+        stats->max_ticks = 0;
+
+        unsigned int i;
+        for (i = 0; i < STIMER_STATS_BUCKETS; ++i) {
+            stats->histogram[i] = 0;
+        }
     }
 }
 
 
-bool
-stimer_is_expired(struct stimer * ts)
+void
+stimer_stats_add(struct stimer_stats * stats, uint64_t ticks)
 {
-    bool expired = false;
-    if (NULL != ts) {
-        if (NULL != ts->ctx) {
-            checkpoint_timer_2(ts);
+    if (NULL != stats) {
+        // Welford's running variance in fixed point: the mean in Q8 before
+        // and after the sample, and the sum of their products
+        uint64_t mean_q8 = stats_mean_q8(stats);
+
+        stats->count += 1;
+        stats->total_ticks += ticks;
+
+        if ((ticks > STATS_Q8_MAX) || (stats->total_ticks > STATS_Q8_MAX) ||
+            (stats->total_ticks < ticks)) {
+            stats->is_saturated = true;
+        }
+        if (!stats->is_saturated) {
+            uint64_t x_q8 = ticks << 8;
+            uint64_t next_mean_q8 = stats_mean_q8(stats);
+
+            // Both deviations have the same sign, apart from rounding
+            bool is_below = x_q8 < mean_q8;
+            bool is_next_below = x_q8 < next_mean_q8;
+            uint64_t d = is_below ? (mean_q8 - x_q8) : (x_q8 - mean_q8);
+            uint64_t next_d = is_next_below ? (next_mean_q8 - x_q8) : (x_q8 - next_mean_q8);
+
+            stats_add_deviation(stats, d, next_d, is_below != is_next_below);
+        }
+
+        stats->min_ticks = (ticks < stats->min_ticks) ? ticks : stats->min_ticks;
+        stats->max_ticks = (ticks > stats->max_ticks) ? ticks : stats->max_ticks;
+
+        unsigned int bucket = (0 != ticks) ? (find_last_set_64(ticks) + 1u) : 0u;
+        if (bucket >= STIMER_STATS_BUCKETS) {
+            bucket = STIMER_STATS_BUCKETS - 1u;
         }
-        expired = is_duration_ge(&ts->elapsed, &ts->expire_interval);
+        stats->histogram[bucket] += 1;
     }
-    return expired;
 }
 
 
-void
-stimer_restart_from_now(struct stimer * ts)
+uint64_t
+stimer_stats_get_mean_ticks(const struct stimer_stats * stats)
 {
-    if ((NULL != ts) && (NULL != ts->ctx) && (ts->is_running)) {
-        start_and_checkpoint_timer(ts);
+    uint64_t mean = 0;
+    if ((NULL != stats) && (0 != stats->count)) {
+        mean = stats->total_ticks / stats->count;
     }
+    return mean;
 }
 
 
-void
-stimer_advance(struct stimer * ts)
+uint64_t
+stimer_stats_get_stddev_ticks(const struct stimer_stats * stats)
 {
-    if ((NULL != ts) && (NULL != ts->ctx) && (ts->is_running)) {
-        checkpoint_timer_2(ts);
-        timer_subtract_from_elapsed(ts, &ts->expire_interval);
+    uint64_t stddev = 0;
+    if ((NULL != stats) && stats->is_saturated) {
+        stddev = UINT64_MAX;
+    } else if ((NULL != stats) && (0 != stats->count)) {
+        // Integer square root of the variance. The fraction of the sum can't
+        // change the variance rounded down to whole ticks squared
+        uint64_t x = stats->squared_deviation_ticks / stats->count;
+        uint64_t bit = (uint64_t) 1 << 62;
+        while (bit > x) {
+            bit >>= 2;
+        }
+        while (0 != bit) {
+            if (x >= (stddev + bit)) {
+                x -= stddev + bit;
+                stddev = (stddev >> 1) + bit;
+            } else {
+                stddev >>= 1;
+            }
+            bit >>= 2;
+        }
     }
+    return stddev;
 }
@@ -50,6 +50,60 @@ struct stimer_ctx;
 struct stimer;
 
 
+// --------------------- Interval class
+struct stimer_class;
+
+
+// -------------------------- Stopwatch
+
+/**
+ * Stopwatch, a value type that is never linked into the timer context
+ */
+struct stimer_stopwatch {
+    struct stimer_ctx * ctx;
+    uint64_t start_ticks;
+};
+
+
+// ------------------------- Statistics
+
+// Number of log2 histogram buckets in the statistics
+#define STIMER_STATS_BUCKETS            32
+
+/**
+ * Elapsed time statistics, in get_time_fn ticks. Bucket 0 of the histogram
+ * counts samples of 0 ticks, and bucket n samples of 2^(n-1) to 2^n - 1
+ * ticks. The last bucket also counts every longer sample. The variance is
+ * kept as a running sum of squared deviations from the mean, in ticks
+ * squared plus a 1/65536 fraction, and is_saturated is set once it no
+ * longer fits.
+ */
+struct stimer_stats {
+    uint32_t count;
+    bool is_saturated;
+    uint16_t squared_deviation_fraction;
+    uint64_t total_ticks;
+    uint64_t squared_deviation_ticks;
+    uint64_t min_ticks;
+    uint64_t max_ticks;
+    uint32_t histogram[STIMER_STATS_BUCKETS];
+};
+
+
+// --------------------------- Deadline
+
+/**
+ * Absolute deadline on the context clock, a value type that is never linked
+ * into the timer context. excess_ns is how far the deadline was rounded up
+ * past the exact time, carried when the deadline is advanced
+ */
+struct stimer_deadline {
+    struct stimer_ctx * ctx;
+    uint64_t deadline_ticks;
+    uint32_t excess_ns;
+};
+
+
 // -------------------------------------------------------------- Timer context
 
 /**
@@ -69,6 +123,20 @@ struct stimer;
 typedef uint32_t (*stimer_get_time_fn)(void * hint);
 
 
+/**
+ * @brief Function pointer prototype for programming a hardware alarm
+ * @details The implementation should arrange for stimer_execute_context to
+ *          be called once the get_time_fn value reaches alarm_time, for
+ *          example by loading a compare-match register. A newly programmed
+ *          alarm replaces any previously programmed one.
+ *
+ * @param hint Optional hint parameter, as passed to
+ *          stimer_set_alarm_callback
+ * @param alarm_time Value of get_time_fn at which the alarm should fire
+ */
+typedef void (*stimer_set_alarm_fn)(void * hint, uint32_t alarm_time);
+
+
 /**
  * @brief Allocates a timer context structure on the heap
  *
@@ -77,7 +145,7 @@ typedef uint32_t (*stimer_get_time_fn)(void * hint);
  *          set to NULL
  * @param get_time_fn Get time function pointer
  * @param max_time Maximum value that can be returned by the get_time_fn
- * @param ns_per_count Nanoseconds per get_time_fn tick
+ * @param ns_per_count Nanoseconds per get_time_fn tick, must not be 0
  * @return Timer context, or NULL on an error
  */
 struct stimer_ctx *
@@ -109,6 +177,180 @@ void
 stimer_execute_context(struct stimer_ctx * ctx);
 
 
+/**
+ * @brief Bounded version of stimer_execute_context
+ * @details Visits at most max_timers timers per call, resuming where the
+ *          previous call left off. This bounds the worst case execution time
+ *          of a call regardless of how many timers are allocated. Every
+ *          call drives the rollover logic, whatever the budget, so the rate
+ *          requirement is the same as for stimer_execute_context. Interval
+ *          class timers that expire count against the budget too. When an
+ *          alarm callback is set, the alarm is reprogrammed at the end of
+ *          each complete pass. Calling stimer_execute_context abandons a
+ *          pass in progress and runs a complete one. With an index backend
+ *          (see STIMER_CONFIG_BACKEND) only expiring timers are visited, and
+ *          a pass is complete once no expired timers are left.
+ *
+ * @param ctx Timer context to execute
+ * @param max_timers Maximum number of timers to visit in this call
+ * @return true if this call completed a pass over all timers, else false
+ */
+bool
+stimer_execute_context_budget(struct stimer_ctx * ctx, uint32_t max_timers);
+
+
+/**
+ * @brief Sets the alarm callback used to run the context interrupt driven
+ * @details Once set, the context calls set_alarm_fn with the get_time_fn
+ *          value of the earliest pending expiration whenever it moves. The
+ *          alarm is never programmed further out than a quarter of the
+ *          get_time_fn rollover, so servicing every alarm with a call to
+ *          stimer_execute_context also satisfies its rollover requirement.
+ *          The alarm may fire early after a timer is stopped or freed; the
+ *          next stimer_execute_context call reprograms it.
+ *          The callback is called once immediately to program the first
+ *          alarm. Set set_alarm_fn to NULL to disable.
+ *
+ * @param ctx Timer context
+ * @param hint Optional hint parameter for the set_alarm_fn function
+ * @param set_alarm_fn Set alarm function pointer, or NULL
+ */
+void
+stimer_set_alarm_callback(struct stimer_ctx * ctx,
+                          void * hint,
+                          stimer_set_alarm_fn set_alarm_fn);
+
+
+/**
+ * @brief Gets the time until the next pending expiration
+ * @details Intended for tickless sleeping, i.e. sleep for the returned time
+ *          and then call stimer_execute_context. The result may be earlier
+ *          than the actual expiration, never later, and is capped to a
+ *          quarter of the get_time_fn rollover like the alarm. It is 0 while
+ *          an expiration that has passed still waits for an execute pass.
+ *          With the default list backend this visits every timer; the index
+ *          backends (see STIMER_CONFIG_BACKEND) answer in constant time.
+ *
+ * @param ctx Timer context
+ * @return get_time_fn counts until the next expiration
+ */
+uint32_t
+stimer_get_ticks_until_next(struct stimer_ctx * ctx);
+
+
+// -------------------------------------------------------------- Context clock
+
+/**
+ * @brief Reads the context clock
+ * @details The context clock counts get_time_fn ticks since the context was
+ *          allocated, extended to 64 bits so it never rolls over. It can be
+ *          used to build timeouts and measurements that are plain values
+ *          instead of timers, and so are never visited by
+ *          stimer_execute_context. The same rollover requirement applies,
+ *          the context must be executed or its clock read at least 4 times
+ *          faster than the get_time_fn value rollover.
+ *
+ * @param ctx Timer context
+ * @return Context clock ticks
+ */
+uint64_t
+stimer_get_context_ticks(struct stimer_ctx * ctx);
+
+
+/**
+ * @brief Converts a duration to context clock ticks, rounded up
+ *
+ * @param ctx Timer context
+ * @param t Duration
+ * @return Ticks
+ */
+uint64_t
+stimer_duration_to_ticks(struct stimer_ctx * ctx, struct stimer_duration * t);
+
+
+/**
+ * @brief Converts milliseconds to context clock ticks, rounded up
+ *
+ * @param ctx Timer context
+ * @param ms Milliseconds
+ * @return Ticks
+ */
+uint64_t
+stimer_ms_to_ticks(struct stimer_ctx * ctx, uint32_t ms);
+
+
+/**
+ * @brief Converts microseconds to context clock ticks, rounded up
+ *
+ * @param ctx Timer context
+ * @param us Microseconds
+ * @return Ticks
+ */
+uint64_t
+stimer_us_to_ticks(struct stimer_ctx * ctx, uint32_t us);
+
+
+/**
+ * @brief Converts milliseconds to context clock ticks, carrying the rounding
+ * @details For moving a deadline forward by an interval that is not a whole
+ *          number of ticks. excess_ns is how far the deadline was rounded
+ *          past the exact time, and is updated for the new deadline, so a
+ *          series of intervals adds up to their exact total rather than
+ *          drifting by the rounding of each one. Start it at 0.
+ *
+ * @param ctx Timer context
+ * @param ms Milliseconds
+ * @param excess_ns Rounding carried from the previous interval, updated
+ * @return Ticks
+ */
+uint64_t
+stimer_ms_to_ticks_carry(struct stimer_ctx * ctx, uint32_t ms, uint32_t * excess_ns);
+
+
+/**
+ * @brief Converts context clock ticks to a duration
+ *
+ * @param ctx Timer context
+ * @param ticks Ticks
+ * @param t Duration structure to put the time into
+ */
+void
+stimer_ticks_to_duration(struct stimer_ctx * ctx,
+                         uint64_t ticks,
+                         struct stimer_duration * t);
+
+
+// ------------------------------------------------------------- Interval class
+
+/**
+ * @brief Allocates an interval class on the heap
+ * @details An interval class is a group of timers that all expire after the
+ *          same interval. Since they expire in the order they were armed,
+ *          the class keeps them in a FIFO queue. Arming and cancelling are
+ *          constant time, and stimer_execute_context only needs to look at
+ *          the head of the queue, no matter how many timers are queued.
+ *          Interval classes add to every timer, and are only built in with
+ *          STIMER_CONFIG_CLASSES defined to 1.
+ *
+ * @param ctx Timer context the class belongs to
+ * @param t Interval of the timers in the class
+ * @return Interval class, or NULL on an error or if interval classes are not
+ *         built in
+ */
+struct stimer_class *
+stimer_alloc_class(struct stimer_ctx * ctx, struct stimer_duration * t);
+
+
+/**
+ * @brief Deallocates an interval class
+ * @details Timers in the class keep running as ordinary timers
+ *
+ * @param cls Interval class to free
+ */
+void
+stimer_free_class(struct stimer_class * cls);
+
+
 // --------------------------------------------------------------- Timer handle
 
 /**
@@ -156,7 +398,9 @@ stimer_stop(struct stimer * ts);
  * @details This can be called on a timer previously started with the
  *          stimer_start function or any of the stimer_expire_from_now_*
  *          functions. The timer does not need to be stopped first before
- *          calling this
+ *          calling this. A timer whose context was freed has no clock or
+ *          tick rate left, and reports no elapsed time, as do the other
+ *          elapsed and remaining time getters.
  *
  * @param ts Timer handle
  * @param t Timer duration structure to put elapsed time into
@@ -165,6 +409,63 @@ void
 stimer_get_elapsed_time(struct stimer * ts, struct stimer_duration * t);
 
 
+/**
+ * @brief Gets the amount of time elapsed on a timer in get_time_fn ticks
+ * @details Same as stimer_get_elapsed_time, without any unit conversion
+ *
+ * @param ts Timer handle
+ * @return Elapsed ticks
+ */
+uint64_t
+stimer_get_elapsed_ticks(struct stimer * ts);
+
+
+/**
+ * @brief Gets the amount of time elapsed on a timer in nanoseconds
+ * @details Same as stimer_get_elapsed_time, without splitting the result into
+ *          seconds and nanoseconds
+ *
+ * @param ts Timer handle
+ * @return Elapsed nanoseconds
+ */
+uint64_t
+stimer_get_elapsed_ns64(struct stimer * ts);
+
+
+/**
+ * @brief Gets the time elapsed on a timer, and restarts it
+ * @details This is a lap or split for a timer started with stimer_start. The
+ *          restart uses the same clock read as the measurement, so
+ *          consecutive laps add up to the total time with nothing lost. The
+ *          lap is recorded in the timer statistics, if any. Does nothing on
+ *          a timer that is not running or is set to expire.
+ *
+ * @param ts Timer handle
+ * @return Elapsed ticks of the lap
+ */
+uint64_t
+stimer_lap(struct stimer * ts);
+
+
+/**
+ * @brief Sets the statistics that a timer records its elapsed times into
+ * @details This makes the timer a profiling timer. Every stimer_stop of a
+ *          running timer, and every stimer_lap, adds the elapsed time to the
+ *          statistics, so a profiled section costs a stimer_start and a
+ *          stimer_stop call. The statistics are owned by the caller and may
+ *          be shared by several timers. Set stats to NULL to stop recording.
+ *          This replaces any stimer_set_jitter_stats. Timer statistics add
+ *          to every timer, and are only built in with STIMER_CONFIG_STATS
+ *          defined to 1.
+ *
+ * @param ts Timer handle
+ * @param stats Statistics, or NULL
+ * @return True if set, false if timer statistics are not built in
+ */
+bool
+stimer_set_stats(struct stimer * ts, struct stimer_stats * stats);
+
+
 // ----------------------------------------------------- Expire timer functions
 
 /**
@@ -217,9 +518,38 @@ void
 stimer_expire_from_now_ns(struct stimer * ts, uint32_t ns);
 
 
+/**
+ * @brief Sets the timer up to expire at a point in time from now
+ * @details Unlike the other stimer_expire_from_now_* functions, this needs no
+ *          unit conversion at all
+ *
+ * @param ts Timer handle
+ * @param ticks get_time_fn ticks until expiration
+ */
+void
+stimer_expire_from_now_ticks(struct stimer * ts, uint32_t ticks);
+
+
+/**
+ * @brief Sets the timer up to expire one class interval from now
+ * @details The timer joins the interval class until it expires, is stopped,
+ *          or is armed with any of the other stimer_expire_from_now_*
+ *          functions. stimer_restart_from_now, stimer_advance and stimer_kick
+ *          keep it in the class.
+ *
+ * @param ts Timer handle
+ * @param cls Interval class, from the same context as the timer
+ */
+void
+stimer_expire_from_now_class(struct stimer * ts, struct stimer_class * cls);
+
+
 /**
  * @brief Checks if a timer has expired
  *
+ * @details A timer whose context has been freed has no time left, so it is
+ *          reported as expired
+ *
  * @param ts Timer handle
  * @return true if the timer has expired, else false
  */
@@ -227,6 +557,21 @@ bool
 stimer_is_expired(struct stimer * ts);
 
 
+/**
+ * @brief Gets the time left until a timer expires
+ * @details This answers the same question as stimer_is_expired, from the same
+ *          time checkpoint, so the two results are always consistent. A
+ *          timer whose context has been freed reports 0 and expired
+ *
+ * @param ts Timer handle
+ * @param t Timer duration structure to put the remaining time into. This is
+ *          set to 0 if the timer has expired. Can be NULL
+ * @return true if the timer has expired, else false
+ */
+bool
+stimer_get_remaining_time(struct stimer * ts, struct stimer_duration * t);
+
+
 /**
  * @brief Restarts a timer to expire at a point in the future from now.
  * @details This reuses the expiration duration previously set with one of the
@@ -252,6 +597,349 @@ void
 stimer_advance(struct stimer * ts);
 
 
+/**
+ * @brief Lazily restarts a timer to expire at a point in the future from now
+ * @details This is a cheaper version of stimer_restart_from_now for timers that
+ *          are restarted far more often than they expire, such as watchdogs.
+ *          It only reads the clock and records the time of the kick, without
+ *          moving the timer. The timer keeps its previous expiration time
+ *          until that is reached, and is then moved to expire one interval
+ *          after the last kick, with its elapsed time counted from the kick.
+ *          A timer whose expiration was already reached is moved right away.
+ *          Kicks add to every timer, and are only built in with
+ *          STIMER_CONFIG_KICK defined to 1.
+ *
+ * @param ts Timer handle
+ * @return True if kicked, false if kicks are not built in
+ */
+bool
+stimer_kick(struct stimer * ts);
+
+
+/**
+ * @brief Kicks a timer at an already read context time
+ * @details The same as stimer_kick, without reading the clock. Read it once
+ *          with stimer_get_context_ticks to kick many timers at the same
+ *          time. A time after the last clock read is taken as that read.
+ *
+ * @param ts Timer handle
+ * @param now_ticks Context clock ticks of the kick
+ * @return True if kicked, false if kicks are not built in
+ */
+bool
+stimer_kick_at(struct stimer * ts, uint64_t now_ticks);
+
+
+/**
+ * @brief Function pointer prototype for timer expiration callbacks
+ *
+ * @param hint Hint parameter given to stimer_set_expire_callback
+ * @param ts Timer handle that expired
+ */
+typedef void (*stimer_expire_fn)(void * hint, struct stimer * ts);
+
+
+/**
+ * @brief Sets a callback for when the timer expires
+ * @details stimer_execute_context calls expire_fn once for each expiration
+ *          it sees, so the timer does not have to be polled. Arming,
+ *          restarting or advancing the timer allows the next expiration to
+ *          be reported. With an index backend only expired timers are
+ *          visited to do this. The callback may arm, stop or free any timer,
+ *          but must not free an interval class or the context, or execute
+ *          the context. Expire callbacks add to every timer, and are only
+ *          built in with STIMER_CONFIG_EXPIRE_CALLBACK defined to 1.
+ *
+ * @param ts Timer handle
+ * @param hint Optional hint parameter for the expire_fn function
+ * @param expire_fn Expiration callback, or NULL to disable
+ * @return True if set, false if expire callbacks are not built in
+ */
+bool
+stimer_set_expire_callback(struct stimer * ts, void * hint, stimer_expire_fn expire_fn);
+
+
+/**
+ * @brief Sets the statistics that a periodic timer records its jitter into
+ * @details Every stimer_advance of an expired timer adds how late it is, in
+ *          ticks past the ideal expiration time, to the statistics. With a
+ *          steady periodic loop this is the release jitter of the loop, and
+ *          the min, max, standard deviation and histogram of the lateness
+ *          show how well it keeps its schedule, where the average period
+ *          alone would not. The statistics are owned by the caller. Set
+ *          stats to NULL to stop recording. A timer records either elapsed
+ *          times or jitter, so this replaces stimer_set_stats, and is only
+ *          built in with STIMER_CONFIG_STATS defined to 1.
+ *
+ * @param ts Timer handle
+ * @param stats Statistics, or NULL
+ * @return True if set, false if timer statistics are not built in
+ */
+bool
+stimer_set_jitter_stats(struct stimer * ts, struct stimer_stats * stats);
+
+
+/**
+ * @brief Gets the time left until a timer expires in get_time_fn ticks
+ *
+ * @param ts Timer handle
+ * @return Ticks until expiration, or 0 if the timer has expired
+ */
+uint64_t
+stimer_get_remaining_ticks(struct stimer * ts);
+
+
+/**
+ * @brief Gets the time left until a timer expires in nanoseconds
+ *
+ * @param ts Timer handle
+ * @return Nanoseconds until expiration, or 0 if the timer has expired
+ */
+uint64_t
+stimer_get_remaining_ns64(struct stimer * ts);
+
+
+// ------------------------------------------------------------------ Stopwatch
+
+/**
+ * @brief Starts a stopwatch
+ * @details A stopwatch measures elapsed time like stimer_start and
+ *          stimer_get_elapsed_time, but is a plain value that can live on
+ *          the stack. It is not allocated and not linked into the context,
+ *          so it adds nothing to stimer_execute_context, and only uses the
+ *          context for clock reads and unit conversion. The same rollover
+ *          requirement as a timer applies to the measured interval.
+ *
+ * @param sw Stopwatch
+ * @param ctx Timer context, used for the clock
+ */
+void
+stimer_stopwatch_start(struct stimer_stopwatch * sw, struct stimer_ctx * ctx);
+
+
+/**
+ * @brief Gets the time elapsed since a stopwatch was started
+ *
+ * @param sw Stopwatch
+ * @param t Timer duration structure to put elapsed time into
+ */
+void
+stimer_stopwatch_get_elapsed_time(struct stimer_stopwatch * sw,
+                                  struct stimer_duration * t);
+
+
+/**
+ * @brief Gets the time elapsed since a stopwatch was started in get_time_fn
+ *        ticks
+ *
+ * @param sw Stopwatch
+ * @return Elapsed ticks
+ */
+uint64_t
+stimer_stopwatch_get_elapsed_ticks(struct stimer_stopwatch * sw);
+
+
+/**
+ * @brief Gets the time elapsed since a stopwatch was started in nanoseconds
+ *
+ * @param sw Stopwatch
+ * @return Elapsed nanoseconds
+ */
+uint64_t
+stimer_stopwatch_get_elapsed_ns64(struct stimer_stopwatch * sw);
+
+
+/**
+ * @brief Gets the time elapsed since a stopwatch was started, and restarts it
+ * @details The restart uses the same clock read as the measurement, so
+ *          consecutive laps add up to the total time with nothing lost
+ *
+ * @param sw Stopwatch
+ * @return Elapsed ticks of the lap
+ */
+uint64_t
+stimer_stopwatch_lap_ticks(struct stimer_stopwatch * sw);
+
+
+// ------------------------------------------------------------------- Deadline
+
+/**
+ * @brief Sets a deadline at a point in the future from now
+ * @details A deadline is a plain value for passing timeouts down a call stack.
+ *          Each layer can check it, ask for the time left, or shrink it to a
+ *          tighter local timeout with stimer_deadline_min, without allocating
+ *          a timer. The same rollover requirement as a timer applies.
+ *
+ * @param dl Deadline
+ * @param ctx Timer context, used for the clock
+ * @param t Time until the deadline
+ */
+void
+stimer_deadline_from_now(struct stimer_deadline * dl,
+                         struct stimer_ctx * ctx,
+                         struct stimer_duration * t);
+
+
+/**
+ * @brief Sets a deadline at a point in the future from now
+ *
+ * @param dl Deadline
+ * @param ctx Timer context, used for the clock
+ * @param ms Milliseconds until the deadline
+ */
+void
+stimer_deadline_from_now_ms(struct stimer_deadline * dl,
+                            struct stimer_ctx * ctx,
+                            uint32_t ms);
+
+
+/**
+ * @brief Sets a deadline at a point in the future from now
+ *
+ * @param dl Deadline
+ * @param ctx Timer context, used for the clock
+ * @param us Microseconds until the deadline
+ */
+void
+stimer_deadline_from_now_us(struct stimer_deadline * dl,
+                            struct stimer_ctx * ctx,
+                            uint32_t us);
+
+
+/**
+ * @brief Moves a deadline forward by an interval from where it was
+ * @details Like stimer_advance, this can be used for a steady periodic wait.
+ *          The rounding to ticks is carried from one interval to the next,
+ *          so the deadline does not drift when the interval is not a whole
+ *          number of ticks. A deadline that never expires is left as is.
+ *
+ * @param dl Deadline
+ * @param ms Interval in milliseconds
+ */
+void
+stimer_deadline_advance_ms(struct stimer_deadline * dl, uint32_t ms);
+
+
+/**
+ * @brief Sets a deadline that never expires
+ *
+ * @param dl Deadline
+ * @param ctx Timer context, used for the clock
+ */
+void
+stimer_deadline_never(struct stimer_deadline * dl, struct stimer_ctx * ctx);
+
+
+/**
+ * @brief Checks if a deadline has passed
+ *
+ * @param dl Deadline
+ * @return true if the deadline has passed, else false
+ */
+bool
+stimer_deadline_is_expired(const struct stimer_deadline * dl);
+
+
+/**
+ * @brief Gets the time left until a deadline
+ *
+ * @param dl Deadline
+ * @param t Timer duration structure to put remaining time into, 0 if the
+ *          deadline has passed, or UINT32_MAX seconds if it never expires
+ * @return true if the deadline has passed, else false
+ */
+bool
+stimer_deadline_get_remaining_time(const struct stimer_deadline * dl,
+                                   struct stimer_duration * t);
+
+
+/**
+ * @brief Gets the time left until a deadline in get_time_fn ticks
+ *
+ * @param dl Deadline
+ * @return Ticks until the deadline, 0 if it has passed, or UINT64_MAX if it
+ *         never expires
+ */
+uint64_t
+stimer_deadline_get_remaining_ticks(const struct stimer_deadline * dl);
+
+
+/**
+ * @brief Gets the earlier of two deadlines
+ * @details Deadlines from different contexts can't be compared, and a is
+ *          returned
+ *
+ * @param a Deadline
+ * @param b Deadline
+ * @return The earlier deadline
+ */
+struct stimer_deadline
+stimer_deadline_min(struct stimer_deadline a, struct stimer_deadline b);
+
+
+/**
+ * @brief Shrinks a deadline to at most a number of milliseconds from now
+ * @details Same as stimer_deadline_min with a deadline ms from now, for a
+ *          layer that adds its own timeout to one passed in
+ *
+ * @param dl Deadline
+ * @param ms Milliseconds from now
+ */
+void
+stimer_deadline_limit_ms(struct stimer_deadline * dl, uint32_t ms);
+
+
+// ----------------------------------------------------------------- Statistics
+
+/**
+ * @brief Clears statistics
+ *
+ * @param stats Statistics
+ */
+void
+stimer_stats_reset(struct stimer_stats * stats);
+
+
+/**
+ * @brief Adds an elapsed time to statistics
+ * @details Timers with statistics call this on every stop, it can also be
+ *          used to record stopwatch measurements
+ *
+ * @param stats Statistics
+ * @param ticks Elapsed get_time_fn ticks
+ */
+void
+stimer_stats_add(struct stimer_stats * stats, uint64_t ticks);
+
+
+/**
+ * @brief Gets the mean elapsed time of statistics
+ *
+ * @param stats Statistics
+ * @return Mean elapsed ticks, rounded down, or 0 without samples
+ */
+uint64_t
+stimer_stats_get_mean_ticks(const struct stimer_stats * stats);
+
+
+/**
+ * @brief Gets the standard deviation of statistics
+ * @details The deviations are summed around the running mean in integer
+ *          arithmetic, so large samples with a small spread, such as long
+ *          periods, keep an exact result. The sum saturates once the sample
+ *          count times the variance passes 2^64 ticks squared, i.e. after
+ *          about 18 million samples with a standard deviation of 1 ms in
+ *          nanosecond ticks, or 1800 samples with 100 ms. The total of all
+ *          samples must also stay below 2^56 ticks.
+ *
+ * @param stats Statistics
+ * @return Population standard deviation in ticks, rounded down, 0 without
+ *         samples, or UINT64_MAX if the statistics are saturated
+ */
+uint64_t
+stimer_stats_get_stddev_ticks(const struct stimer_stats * stats);
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,361 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_HPP_
+#define STIMER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+#include <type_traits>
+
+#include "stimer.h"
+
+
+namespace soft_timer {
+
+// ----------------------------------------------------------- Private helpers
+
+namespace detail {
+
+// C API unit a duration is passed in
+enum class unit { s, ms, us, ns, other };
+
+
+template <class Period, class Unit>
+struct is_multiple_of
+    : std::integral_constant<bool, std::ratio_divide<Period, Unit>::den == 1> {};
+
+
+// Coarsest unit that the period is an exact multiple of, picked at compile
+// time so the conversion is a multiply by a constant
+template <class Rep, class Period>
+struct unit_for
+    : std::integral_constant<unit,
+        std::chrono::treat_as_floating_point<Rep>::value  ? unit::other :
+        is_multiple_of<Period, std::ratio<1>>::value      ? unit::s :
+        is_multiple_of<Period, std::milli>::value         ? unit::ms :
+        is_multiple_of<Period, std::micro>::value         ? unit::us :
+        is_multiple_of<Period, std::nano>::value          ? unit::ns :
+                                                            unit::other> {};
+
+
+template <class Period, class Unit>
+struct multiplier
+    : std::integral_constant<std::intmax_t,
+        std::ratio_divide<Period, Unit>::num / std::ratio_divide<Period, Unit>::den> {};
+
+
+inline struct stimer_duration
+to_duration(std::chrono::nanoseconds d)
+{
+    // Split into seconds and nanoseconds, for anything that does not fit
+    // one of the 32 bit unit calls
+    typedef std::chrono::nanoseconds::rep rep;
+    const rep ns_per_s = 1000000000;
+    rep ns = (d.count() > 0) ? d.count() : 0;
+
+    struct stimer_duration t;
+    t.seconds = (ns / ns_per_s > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(ns / ns_per_s);
+    t.nanoseconds = static_cast<uint32_t>(ns % ns_per_s);
+    return t;
+}
+
+
+inline void
+expire_from_now(struct stimer * ts, std::chrono::nanoseconds d)
+{
+    struct stimer_duration t = to_duration(d);
+    stimer_expire_from_now(ts, &t);
+}
+
+
+template <class Rep, class Period>
+inline std::chrono::nanoseconds
+ceil_ns(std::chrono::duration<Rep, Period> d)
+{
+    std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d);
+    return (ns < d) ? (ns + std::chrono::nanoseconds(1)) : ns;
+}
+
+
+template <class Unit, class Rep, class Period>
+inline void
+expire_from_now_in(struct stimer * ts,
+                   std::chrono::duration<Rep, Period> d,
+                   void (*expire_fn)(struct stimer *, uint32_t))
+{
+    // The multiplier is a compile time constant. Counts that do not fit in
+    // 32 bits of the unit take the seconds and nanoseconds path
+    const std::intmax_t scale = multiplier<Period, Unit>::value;
+    const std::intmax_t count = static_cast<std::intmax_t>(d.count());
+
+    if (count <= 0) {
+        expire_fn(ts, 0);
+    } else if (count <= static_cast<std::intmax_t>(UINT32_MAX / scale)) {
+        expire_fn(ts, static_cast<uint32_t>(count * scale));
+    } else {
+        expire_from_now(ts, ceil_ns(d));
+    }
+}
+
+} // namespace detail
+
+
+// -------------------------------------------------------------- Timer context
+
+/**
+ * @brief Move only owner of a struct stimer_ctx
+ * @details Allocation failure leaves the context empty, see operator bool.
+ *          Timers may outlive their context; they stop counting once it is
+ *          destroyed.
+ */
+class Context {
+public:
+    /**
+     * @brief Allocates a timer context, see stimer_alloc_context
+     */
+    Context(void * hint,
+            stimer_get_time_fn get_time_fn,
+            uint32_t max_time,
+            uint32_t ns_per_count) noexcept
+        : ctx_(stimer_alloc_context(hint, get_time_fn, max_time, ns_per_count))
+    {}
+
+    /**
+     * @brief Allocates a timer context with the time per count as a duration
+     */
+    template <class Rep, class Period>
+    Context(void * hint,
+            stimer_get_time_fn get_time_fn,
+            uint32_t max_time,
+            std::chrono::duration<Rep, Period> per_count) noexcept
+        : ctx_(stimer_alloc_context(hint, get_time_fn, max_time, static_cast<uint32_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(per_count).count())))
+    {}
+
+    ~Context() { stimer_free_context(ctx_); }
+
+    Context(Context && other) noexcept : ctx_(other.ctx_) { other.ctx_ = nullptr; }
+
+    Context &
+    operator=(Context && other) noexcept
+    {
+        if (this != &other) {
+            stimer_free_context(ctx_);
+            ctx_ = other.ctx_;
+            other.ctx_ = nullptr;
+        }
+        return *this;
+    }
+
+    Context(const Context &) = delete;
+    Context & operator=(const Context &) = delete;
+
+    /**
+     * @brief True if the context was allocated
+     */
+    explicit operator bool() const noexcept { return nullptr != ctx_; }
+
+    /**
+     * @brief Underlying context, for the C API
+     */
+    struct stimer_ctx * get() const noexcept { return ctx_; }
+
+    /**
+     * @brief See stimer_execute_context
+     */
+    void execute() noexcept { stimer_execute_context(ctx_); }
+
+    /**
+     * @brief See stimer_execute_context_budget
+     */
+    bool execute(uint32_t max_timers) noexcept
+    {
+        return stimer_execute_context_budget(ctx_, max_timers);
+    }
+
+    /**
+     * @brief See stimer_set_alarm_callback
+     */
+    void
+    set_alarm_callback(void * hint, stimer_set_alarm_fn set_alarm_fn) noexcept
+    {
+        stimer_set_alarm_callback(ctx_, hint, set_alarm_fn);
+    }
+
+    /**
+     * @brief See stimer_get_ticks_until_next
+     */
+    uint32_t ticks_until_next() const noexcept { return stimer_get_ticks_until_next(ctx_); }
+
+private:
+    struct stimer_ctx * ctx_;
+};
+
+
+// ---------------------------------------------------------------------- Timer
+
+/**
+ * @brief Move only owner of a struct stimer
+ * @details Durations are std::chrono durations. Ones in whole seconds,
+ *          milliseconds, microseconds or nanoseconds map onto the matching C
+ *          call at compile time; anything else is rounded up to nanoseconds.
+ *          Allocation failure leaves the timer empty, see operator bool.
+ */
+class Timer {
+public:
+    /**
+     * @brief Empty timer, owns nothing
+     */
+    Timer() noexcept : ts_(nullptr) {}
+
+    /**
+     * @brief Allocates a timer in a context, see stimer_alloc
+     */
+    explicit Timer(Context & ctx) noexcept : ts_(stimer_alloc(ctx.get())) {}
+
+    ~Timer() { stimer_free(ts_); }
+
+    Timer(Timer && other) noexcept : ts_(other.ts_) { other.ts_ = nullptr; }
+
+    Timer &
+    operator=(Timer && other) noexcept
+    {
+        if (this != &other) {
+            stimer_free(ts_);
+            ts_ = other.ts_;
+            other.ts_ = nullptr;
+        }
+        return *this;
+    }
+
+    Timer(const Timer &) = delete;
+    Timer & operator=(const Timer &) = delete;
+
+    /**
+     * @brief True if the timer was allocated
+     */
+    explicit operator bool() const noexcept { return nullptr != ts_; }
+
+    /**
+     * @brief Underlying timer, for the C API
+     */
+    struct stimer * get() const noexcept { return ts_; }
+
+    /**
+     * @brief See stimer_start
+     */
+    void start() noexcept { stimer_start(ts_); }
+
+    /**
+     * @brief See stimer_stop
+     */
+    void stop() noexcept { stimer_stop(ts_); }
+
+    /**
+     * @brief See stimer_expire_from_now_s and friends
+     */
+    template <class Rep, class Period>
+    void
+    expire_from_now(std::chrono::duration<Rep, Period> d) noexcept
+    {
+        using detail::unit;
+        switch (detail::unit_for<Rep, Period>::value) {
+        case unit::s:
+            detail::expire_from_now_in<std::ratio<1>>(ts_, d, stimer_expire_from_now_s);
+            break;
+        case unit::ms:
+            detail::expire_from_now_in<std::milli>(ts_, d, stimer_expire_from_now_ms);
+            break;
+        case unit::us:
+            detail::expire_from_now_in<std::micro>(ts_, d, stimer_expire_from_now_us);
+            break;
+        case unit::ns:
+            detail::expire_from_now_in<std::nano>(ts_, d, stimer_expire_from_now_ns);
+            break;
+        default:
+            detail::expire_from_now(ts_, detail::ceil_ns(d));
+            break;
+        }
+    }
+
+    /**
+     * @brief See stimer_expire_from_now_ticks
+     */
+    void expire_from_now_ticks(uint32_t ticks) noexcept { stimer_expire_from_now_ticks(ts_, ticks); }
+
+    /**
+     * @brief See stimer_is_expired
+     */
+    bool is_expired() noexcept { return stimer_is_expired(ts_); }
+
+    /**
+     * @brief See stimer_restart_from_now
+     */
+    void restart_from_now() noexcept { stimer_restart_from_now(ts_); }
+
+    /**
+     * @brief See stimer_advance
+     */
+    void advance() noexcept { stimer_advance(ts_); }
+
+    /**
+     * @brief See stimer_kick
+     */
+    bool kick() noexcept { return stimer_kick(ts_); }
+
+    /**
+     * @brief Elapsed time, see stimer_get_elapsed_ns64
+     */
+    std::chrono::nanoseconds elapsed() const noexcept { return to_ns(stimer_get_elapsed_ns64(ts_)); }
+
+    /**
+     * @brief Remaining time, see stimer_get_remaining_ns64
+     */
+    std::chrono::nanoseconds remaining() const noexcept { return to_ns(stimer_get_remaining_ns64(ts_)); }
+
+    /**
+     * @brief See stimer_get_elapsed_ticks
+     */
+    uint64_t elapsed_ticks() const noexcept { return stimer_get_elapsed_ticks(ts_); }
+
+    /**
+     * @brief See stimer_get_remaining_ticks
+     */
+    uint64_t remaining_ticks() const noexcept { return stimer_get_remaining_ticks(ts_); }
+
+private:
+    static std::chrono::nanoseconds
+    to_ns(uint64_t ns) noexcept
+    {
+        typedef std::chrono::nanoseconds::rep rep;
+        const uint64_t max = static_cast<uint64_t>(std::chrono::nanoseconds::max().count());
+        return std::chrono::nanoseconds(static_cast<rep>((ns > max) ? max : ns));
+    }
+
+    struct stimer * ts_;
+};
+
+} // namespace soft_timer
+
+#endif /* STIMER_HPP_ */
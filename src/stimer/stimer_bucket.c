@@ -0,0 +1,197 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "stimer_bucket.h"
+
+// -------------------------------------------------------------- Private types
+
+// Time in ticks and 1/2^32 tick fractions
+struct fine_time {
+    uint64_t                            ticks;
+    uint32_t                            fraction;
+};
+
+
+// ---------------------------------------------------------- Private functions
+
+static inline void
+add_tokens(struct fine_time * t, const struct stimer_rate * rate, uint32_t tokens)
+{
+    // Neither product can overflow, the fraction sum carries into the ticks
+    uint64_t fraction = (uint64_t) t->fraction + ((uint64_t) tokens * rate->token_fraction);
+    t->ticks += ((uint64_t) tokens * rate->token_ticks) + (fraction >> 32);
+    t->fraction = (uint32_t) fraction;
+}
+
+
+static inline bool
+is_later(const struct fine_time * a, const struct fine_time * b)
+{
+    return (a->ticks > b->ticks) || ((a->ticks == b->ticks) && (a->fraction > b->fraction));
+}
+
+
+static uint64_t
+plan_tokens(const struct stimer_rate * rate,
+            const struct stimer_bucket * bucket,
+            uint32_t tokens,
+            struct fine_time * start,
+            struct fine_time * full,
+            struct fine_time * limit)
+{
+    // The bucket is empty at full - burst. Taking tokens moves full later,
+    // which is allowed as long as the bucket does not go below empty, i.e.
+    // full stays at or before now + burst
+    struct fine_time now = { stimer_get_context_ticks(rate->ctx), 0 };
+
+    start->ticks = bucket->full_ticks;
+    start->fraction = bucket->full_fraction;
+    if (is_later(&now, start)) {
+        *start = now;
+    }
+
+    *full = *start;
+    add_tokens(full, rate, tokens);
+
+    *limit = now;
+    add_tokens(limit, rate, rate->burst);
+    return now.ticks;
+}
+
+
+// ----------------------------------------------------------- Public functions
+
+// ---------------------- Rate
+
+bool
+stimer_rate_init(struct stimer_rate * rate,
+                 struct stimer_ctx * ctx,
+                 uint32_t tokens,
+                 struct stimer_duration * period,
+                 uint32_t burst)
+{
+    bool is_ok = false;
+    if ((NULL != rate) && (NULL != ctx) && (0 != tokens) && (NULL != period)) {
+        uint64_t period_ticks = stimer_duration_to_ticks(ctx, period);
+
+        rate->ctx = ctx;
+        rate->token_ticks = period_ticks / tokens;
+        rate->token_fraction = (uint32_t) (((period_ticks % tokens) << 32) / tokens);
+        rate->burst = burst;
+        is_ok = true;
+    }
+    return is_ok;
+}
+
+
+bool
+stimer_rate_init_per_s(struct stimer_rate * rate,
+                       struct stimer_ctx * ctx,
+                       uint32_t tokens_per_s,
+                       uint32_t burst)
+{
+    struct stimer_duration period = { 1, 0 };
+    return stimer_rate_init(rate, ctx, tokens_per_s, &period, burst);
+}
+
+
+// ---------------------- Bucket
+
+void
+stimer_bucket_init(struct stimer_bucket * bucket)
+{
+    if (NULL != bucket) {
+        bucket->full_ticks = 0;
+        bucket->full_fraction = 0;
+    }
+}
+
+
+bool
+stimer_bucket_take(const struct stimer_rate * rate,
+                   struct stimer_bucket * bucket,
+                   uint32_t tokens)
+{
+    bool is_taken = false;
+    if ((NULL != rate) && (NULL != bucket)) {
+        struct fine_time start;
+        struct fine_time full;
+        struct fine_time limit;
+        (void) plan_tokens(rate, bucket, tokens, &start, &full, &limit);
+
+        if (!is_later(&full, &limit)) {
+            bucket->full_ticks = full.ticks;
+            bucket->full_fraction = full.fraction;
+            is_taken = true;
+        }
+    }
+    return is_taken;
+}
+
+
+uint64_t
+stimer_bucket_queue(const struct stimer_rate * rate,
+                    struct stimer_bucket * bucket,
+                    uint32_t units)
+{
+    uint64_t wait_ticks = UINT64_MAX;
+    if ((NULL != rate) && (NULL != bucket)) {
+        struct fine_time start;
+        struct fine_time full;
+        struct fine_time limit;
+        uint64_t now = plan_tokens(rate, bucket, units, &start, &full, &limit);
+
+        if (!is_later(&full, &limit)) {
+            bucket->full_ticks = full.ticks;
+            bucket->full_fraction = full.fraction;
+
+            // The units leave once everything queued before them has, at
+            // the start of their slot, rounded up to a whole tick
+            wait_ticks = start.ticks - now + ((0 != start.fraction) ? 1u : 0u);
+        }
+    }
+    return wait_ticks;
+}
+
+
+uint64_t
+stimer_bucket_get_wait_ticks(const struct stimer_rate * rate,
+                             const struct stimer_bucket * bucket,
+                             uint32_t tokens)
+{
+    uint64_t wait_ticks = UINT64_MAX;
+    if ((NULL != rate) && (NULL != bucket) && (tokens <= rate->burst)) {
+        struct fine_time start;
+        struct fine_time full;
+        struct fine_time limit;
+        (void) plan_tokens(rate, bucket, tokens, &start, &full, &limit);
+
+        wait_ticks = 0;
+        if (is_later(&full, &limit)) {
+            wait_ticks = full.ticks - limit.ticks
+                       + ((full.fraction > limit.fraction) ? 1u : 0u);
+        }
+    }
+    return wait_ticks;
+}
@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_BUCKET_H_
+#define STIMER_BUCKET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stimer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+// ---------------------------------------------------------- Bucket structures
+
+/**
+ * Token rate and bucket size, shared by any number of buckets. The time per
+ * token is kept in ticks and 1/2^32 tick fractions, so slow clocks can still
+ * express fast rates.
+ */
+struct stimer_rate {
+    struct stimer_ctx * ctx;
+    uint64_t token_ticks;
+    uint32_t token_fraction;
+    uint32_t burst;
+};
+
+
+/**
+ * Rate limiter state. This is only the time at which the bucket is next
+ * full, so a bucket is refilled lazily when it is used, and costs nothing
+ * while idle. It is never linked into the context.
+ */
+struct stimer_bucket {
+    uint64_t full_ticks;
+    uint32_t full_fraction;
+};
+
+
+// ----------------------------------------------------------------------- Rate
+
+/**
+ * @brief Sets a token rate
+ *
+ * @param rate Rate
+ * @param ctx Timer context, used for the clock
+ * @param tokens Tokens added to a bucket per period, must not be 0
+ * @param period Period
+ * @param burst Bucket size, the most tokens that can be taken at once
+ * @return true on success, else false
+ */
+bool
+stimer_rate_init(struct stimer_rate * rate,
+                 struct stimer_ctx * ctx,
+                 uint32_t tokens,
+                 struct stimer_duration * period,
+                 uint32_t burst);
+
+
+/**
+ * @brief Sets a token rate in tokens per second
+ *
+ * @param rate Rate
+ * @param ctx Timer context, used for the clock
+ * @param tokens_per_s Tokens added to a bucket per second, must not be 0
+ * @param burst Bucket size, the most tokens that can be taken at once
+ * @return true on success, else false
+ */
+bool
+stimer_rate_init_per_s(struct stimer_rate * rate,
+                       struct stimer_ctx * ctx,
+                       uint32_t tokens_per_s,
+                       uint32_t burst);
+
+
+// --------------------------------------------------------------------- Bucket
+
+/**
+ * @brief Initializes a bucket, full
+ *
+ * @param bucket Bucket
+ */
+void
+stimer_bucket_init(struct stimer_bucket * bucket);
+
+
+/**
+ * @brief Takes tokens from a token bucket
+ * @details This polices the rate. If there are not enough tokens, none are
+ *          taken. The bucket is refilled from the time since it was last
+ *          used, with a single clock read.
+ *
+ * @param rate Rate
+ * @param bucket Bucket
+ * @param tokens Number of tokens to take
+ * @return true if the tokens were taken, else false
+ */
+bool
+stimer_bucket_take(const struct stimer_rate * rate,
+                   struct stimer_bucket * bucket,
+                   uint32_t tokens);
+
+
+/**
+ * @brief Queues units through a leaky bucket
+ * @details This shapes the rate. The bucket is a queue that drains at the
+ *          rate and holds up to burst units. Queued units are accepted and
+ *          the caller waits the returned time before sending them, so they
+ *          leave at the rate without bursts.
+ *
+ * @param rate Rate
+ * @param bucket Bucket
+ * @param units Number of units to queue
+ * @return get_time_fn ticks to wait before sending, or UINT64_MAX if the
+ *         queue is full and the units were not queued
+ */
+uint64_t
+stimer_bucket_queue(const struct stimer_rate * rate,
+                    struct stimer_bucket * bucket,
+                    uint32_t units);
+
+
+/**
+ * @brief Gets the time until tokens can be taken from a token bucket
+ *
+ * @param rate Rate
+ * @param bucket Bucket
+ * @param tokens Number of tokens
+ * @return get_time_fn ticks until the tokens are available, 0 if they are
+ *         available now, or UINT64_MAX if tokens is more than the burst
+ */
+uint64_t
+stimer_bucket_get_wait_ticks(const struct stimer_rate * rate,
+                             const struct stimer_bucket * bucket,
+                             uint32_t tokens);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* STIMER_BUCKET_H_ */
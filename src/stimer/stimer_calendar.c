@@ -0,0 +1,303 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "stimer_private.h"
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_CALENDAR
+
+// ---------------------------------------------------------- Private functions
+
+static inline struct stimer **
+get_bucket(struct stimer_index * cal, uint64_t deadline)
+{
+    return &cal->buckets[(deadline >> cal->width_shift) & (cal->bucket_count - 1)];
+}
+
+
+static void
+file_timer(struct stimer_index * cal, struct stimer * ts)
+{
+    // Sorted insert, ahead of any timers with the same deadline so that runs
+    // of equal deadlines are not walked
+    uint64_t deadline = ts->index_deadline;
+    struct stimer ** bucket = get_bucket(cal, deadline);
+    struct stimer * prev = NULL;
+    struct stimer * next = *bucket;
+
+    while ((NULL != next) && (next->index_deadline < deadline)) {
+        prev = next;
+        next = next->next;
+    }
+
+    ts->prev = prev;
+    ts->next = next;
+    if (NULL != prev) {
+        prev->next = ts;
+    } else {
+        *bucket = ts;
+    }
+    if (NULL != next) {
+        next->prev = ts;
+    }
+
+    if (deadline < cal->last) {
+        cal->last = deadline;
+    }
+    if ((NULL != cal->min) && (deadline < cal->min->index_deadline)) {
+        cal->min = ts;
+    }
+}
+
+
+static void
+unfile_timer(struct stimer_index * cal, struct stimer * ts)
+{
+    if (NULL != ts->prev) {
+        ts->prev->next = ts->next;
+    } else {
+        *get_bucket(cal, ts->index_deadline) = ts->next;
+    }
+    if (NULL != ts->next) {
+        ts->next->prev = ts->prev;
+    }
+    ts->next = NULL;
+    ts->prev = NULL;
+
+    if (cal->min == ts) {
+        cal->min = NULL;
+    }
+}
+
+
+static struct stimer *
+find_min(struct stimer_index * cal)
+{
+    if ((NULL == cal->min) && (0 != cal->size)) {
+        // Walk one year of days from the last minimum. A bucket head that
+        // falls on the day being walked is the earliest timer
+        uint64_t day = cal->last >> cal->width_shift;
+        uint32_t i;
+        for (i = 0; i < cal->bucket_count; ++i, ++day) {
+            struct stimer * ts = cal->buckets[day & (cal->bucket_count - 1)];
+            if ((NULL != ts) && ((ts->index_deadline >> cal->width_shift) == day)) {
+                cal->min = ts;
+                break;
+            }
+        }
+
+        // Nothing within a year, so take the earliest bucket head directly
+        if (NULL == cal->min) {
+            for (i = 0; i < cal->bucket_count; ++i) {
+                struct stimer * ts = cal->buckets[i];
+                if ((NULL != ts) && ((NULL == cal->min) ||
+                        (ts->index_deadline < cal->min->index_deadline))) {
+                    cal->min = ts;
+                }
+            }
+        }
+
+        cal->last = cal->min->index_deadline;
+    }
+    return cal->min;
+}
+
+
+static unsigned int
+estimate_width_shift(struct stimer * all, uint64_t min, uint32_t size)
+{
+    // Histogram of the distance from the earliest deadline, by power of 2
+    uint32_t histogram[65] = { 0 };
+    struct stimer * ts;
+    for (ts = all; NULL != ts; ts = ts->next) {
+        uint64_t distance = ts->index_deadline - min;
+        ++histogram[(0 == distance) ? 0 : (find_last_set_64(distance) + 1)];
+    }
+
+    // Size the days from the spacing of the nearest half of the timers, so
+    // a few far out timers do not spread out the ones about to expire
+    uint32_t count = 0;
+    unsigned int range_shift = 0;
+    while ((count * 2u) < size) {
+        count += histogram[range_shift];
+        ++range_shift;
+    }
+
+    // About 2 to 4 times the average spacing
+    unsigned int count_shift = find_last_set_64(count);
+    unsigned int width_shift = (range_shift > count_shift) ? (range_shift - count_shift) : 0;
+    return (width_shift < 63u) ? width_shift : 63u;
+}
+
+
+static void
+resize_calendar(struct stimer_index * cal, uint32_t bucket_count)
+{
+    struct stimer ** buckets = (struct stimer **)
+        malloc(bucket_count * sizeof(struct stimer *));
+    if (NULL == buckets) {
+        // Keep the current buckets, which only costs speed
+        return;
+    }
+
+    // Pull every timer out into one list
+    struct stimer * all = NULL;
+    uint64_t min = UINT64_MAX;
+    uint32_t i;
+    for (i = 0; i < cal->bucket_count; ++i) {
+        while (NULL != cal->buckets[i]) {
+            struct stimer * ts = cal->buckets[i];
+            cal->buckets[i] = ts->next;
+
+            ts->next = all;
+            all = ts;
+            if (ts->index_deadline < min) {
+                min = ts->index_deadline;
+            }
+        }
+    }
+
+    free(cal->buckets);
+    for (i = 0; i < bucket_count; ++i) {
+        buckets[i] = NULL;
+    }
+
+    cal->buckets = buckets;
+    cal->bucket_count = bucket_count;
+    cal->width_shift = (NULL != all) ? estimate_width_shift(all, min, cal->size) : 0;
+    cal->last = min;
+    cal->min = NULL;
+
+    while (NULL != all) {
+        struct stimer * ts = all;
+        all = ts->next;
+        file_timer(cal, ts);
+    }
+}
+
+
+// ----------------------------------------------------------- Index functions
+
+bool
+stimer_index_init(struct stimer_ctx * ctx)
+{
+    struct stimer_index * cal = &ctx->index;
+
+    cal->buckets = (struct stimer **)
+        malloc(STIMER_CONFIG_CALENDAR_MIN_BUCKETS * sizeof(struct stimer *));
+    if (NULL == cal->buckets) {
+        return false;
+    }
+
+    uint32_t i;
+    for (i = 0; i < STIMER_CONFIG_CALENDAR_MIN_BUCKETS; ++i) {
+        cal->buckets[i] = NULL;
+    }
+    cal->bucket_count = STIMER_CONFIG_CALENDAR_MIN_BUCKETS;
+    cal->width_shift = 0;
+    cal->size = 0;
+    cal->last = ctx->now_ticks;
+    cal->min = NULL;
+    return true;
+}
+
+
+void
+stimer_index_deinit(struct stimer_ctx * ctx)
+{
+    free(ctx->index.buckets);
+    ctx->index.buckets = NULL;
+}
+
+
+void
+stimer_index_insert(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    struct stimer_index * cal = &ctx->index;
+
+    ts->index_deadline = get_expire_deadline(ts);
+    file_timer(cal, ts);
+    ++cal->size;
+
+    if ((cal->size > (2u * cal->bucket_count))
+        && (cal->bucket_count < STIMER_CONFIG_CALENDAR_MAX_BUCKETS)) {
+        resize_calendar(cal, 2u * cal->bucket_count);
+    }
+}
+
+
+void
+stimer_index_remove(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    struct stimer_index * cal = &ctx->index;
+
+    unfile_timer(cal, ts);
+    --cal->size;
+
+    if ((cal->size < (cal->bucket_count / 2u))
+        && (cal->bucket_count > STIMER_CONFIG_CALENDAR_MIN_BUCKETS)) {
+        resize_calendar(cal, cal->bucket_count / 2u);
+    }
+}
+
+
+void
+stimer_index_update(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    struct stimer_index * cal = &ctx->index;
+
+    unfile_timer(cal, ts);
+    ts->index_deadline = get_expire_deadline(ts);
+    file_timer(cal, ts);
+}
+
+
+struct stimer *
+stimer_index_pop_expired(struct stimer_ctx * ctx, uint64_t now)
+{
+    struct stimer * ts = find_min(&ctx->index);
+    if ((NULL != ts) && (ts->index_deadline <= now)) {
+        stimer_index_remove(ctx, ts);
+    } else {
+        ts = NULL;
+    }
+    return ts;
+}
+
+
+uint64_t
+stimer_index_next(struct stimer_ctx * ctx)
+{
+    struct stimer * ts = find_min(&ctx->index);
+    return (NULL != ts) ? ts->index_deadline : UINT64_MAX;
+}
+
+
+struct stimer *
+stimer_index_first(struct stimer_ctx * ctx)
+{
+    return find_min(&ctx->index);
+}
+
+#endif /* STIMER_CONFIG_BACKEND == STIMER_BACKEND_CALENDAR */
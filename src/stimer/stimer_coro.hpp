@@ -0,0 +1,268 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_CORO_HPP_
+#define STIMER_CORO_HPP_
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+
+#include "stimer.hpp"
+
+
+namespace soft_timer {
+
+class Executor;
+
+
+// ----------------------------------------------------------------------- Task
+
+/**
+ * @brief Fire and forget coroutine return type
+ * @details The coroutine starts running when it is called, and its frame is
+ *          freed when it returns. Exceptions that escape it terminate.
+ */
+struct Task {
+    struct promise_type {
+        Task get_return_object() noexcept { return Task(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+
+// -------------------------------------------------------------- Sleep awaiter
+
+/**
+ * @brief Awaitable returned by Executor::sleep_for
+ * @details Lives in the awaiting coroutine frame, and links itself into the
+ *          executor queue while suspended, so a sleep costs no allocation.
+ */
+class SleepAwaiter {
+public:
+    SleepAwaiter(Executor & executor, uint64_t deadline) noexcept
+        : executor_(executor), deadline_(deadline), handle_(),
+          next_(nullptr), prev_(nullptr), is_queued_(false)
+    {}
+
+    ~SleepAwaiter();
+
+    SleepAwaiter(const SleepAwaiter &) = delete;
+    SleepAwaiter & operator=(const SleepAwaiter &) = delete;
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> handle) noexcept;
+    void await_resume() const noexcept {}
+
+private:
+    friend class Executor;
+
+    Executor &                          executor_;
+    uint64_t                            deadline_;
+    std::coroutine_handle<>             handle_;
+
+    // Executor queue, in deadline order
+    SleepAwaiter *                      next_;
+    SleepAwaiter *                      prev_;
+    bool                                is_queued_;
+};
+
+
+// ------------------------------------------------------------------- Executor
+
+/**
+ * @brief Single threaded executor that resumes sleeping coroutines
+ * @details Sleeps are queued in deadline order on the executor, which keeps
+ *          one context timer armed for the earliest of them. That way the
+ *          context alarm and stimer_get_ticks_until_next account for sleeping
+ *          coroutines too. Call run_once wherever stimer_execute_context
+ *          would be called; it executes the context and resumes every
+ *          coroutine whose sleep is over. Coroutines still sleeping when the
+ *          executor is destroyed are destroyed with it.
+ */
+class Executor {
+public:
+    explicit Executor(Context & ctx) noexcept
+        : ctx_(ctx.get()), wake_(ctx), head_(nullptr), tail_(nullptr)
+    {}
+
+    ~Executor()
+    {
+        while (nullptr != head_) {
+            std::coroutine_handle<> handle = head_->handle_;
+            dequeue(head_);
+            handle.destroy();
+        }
+    }
+
+    Executor(const Executor &) = delete;
+    Executor & operator=(const Executor &) = delete;
+
+    /**
+     * @brief True if the executor timer was allocated
+     */
+    explicit operator bool() const noexcept { return static_cast<bool>(wake_); }
+
+    /**
+     * @brief Suspends the awaiting coroutine for at least d
+     */
+    template <class Rep, class Period>
+    SleepAwaiter
+    sleep_for(std::chrono::duration<Rep, Period> d) noexcept
+    {
+        // Let the library round the duration up to whole ticks
+        struct stimer_duration t = detail::to_duration(detail::ceil_ns(d));
+        return SleepAwaiter(*this, now() + stimer_duration_to_ticks(ctx_, &t));
+    }
+
+    /**
+     * @brief Executes the context and resumes the coroutines that are due
+     */
+    void
+    run_once() noexcept
+    {
+        stimer_execute_context(ctx_);
+        resume_due();
+    }
+
+    /**
+     * @brief True if no coroutine is sleeping
+     */
+    bool is_idle() const noexcept { return nullptr == head_; }
+
+private:
+    friend class SleepAwaiter;
+
+    uint64_t now() const noexcept { return stimer_get_context_ticks(ctx_); }
+
+    void
+    enqueue(SleepAwaiter * a) noexcept
+    {
+        // Walk back from the tail, so equal sleeps queue in O(1) and resume
+        // in the order they started
+        SleepAwaiter * prev = tail_;
+        while ((nullptr != prev) && (prev->deadline_ > a->deadline_)) {
+            prev = prev->prev_;
+        }
+
+        a->prev_ = prev;
+        a->next_ = (nullptr != prev) ? prev->next_ : head_;
+        if (nullptr != a->next_) {
+            a->next_->prev_ = a;
+        } else {
+            tail_ = a;
+        }
+        if (nullptr != prev) {
+            prev->next_ = a;
+        } else {
+            head_ = a;
+            arm_wake();
+        }
+        a->is_queued_ = true;
+    }
+
+    void
+    dequeue(SleepAwaiter * a) noexcept
+    {
+        if (nullptr != a->prev_) {
+            a->prev_->next_ = a->next_;
+        } else {
+            head_ = a->next_;
+        }
+        if (nullptr != a->next_) {
+            a->next_->prev_ = a->prev_;
+        } else {
+            tail_ = a->prev_;
+        }
+        a->next_ = nullptr;
+        a->prev_ = nullptr;
+        a->is_queued_ = false;
+    }
+
+    void
+    arm_wake() noexcept
+    {
+        if (nullptr == head_) {
+            wake_.stop();
+        } else {
+            uint64_t t = now();
+            uint64_t ticks = (head_->deadline_ > t) ? (head_->deadline_ - t) : 0;
+            wake_.expire_from_now_ticks(
+                (ticks > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(ticks));
+        }
+    }
+
+    void
+    resume_due() noexcept
+    {
+        // Resumed coroutines may sleep again, and only go back in the queue
+        // behind the current time, so this always ends
+        uint64_t t = now();
+        while ((nullptr != head_) && (head_->deadline_ <= t)) {
+            SleepAwaiter * a = head_;
+            dequeue(a);
+            a->handle_.resume();
+        }
+        arm_wake();
+    }
+
+    struct stimer_ctx *                 ctx_;
+
+    // Expires at the earliest sleep deadline
+    Timer                               wake_;
+
+    SleepAwaiter *                      head_;
+    SleepAwaiter *                      tail_;
+};
+
+
+inline
+SleepAwaiter::~SleepAwaiter()
+{
+    // The frame is being destroyed while suspended
+    if (is_queued_) {
+        executor_.dequeue(this);
+    }
+}
+
+
+inline bool
+SleepAwaiter::await_ready() const noexcept
+{
+    return deadline_ <= executor_.now();
+}
+
+
+inline void
+SleepAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    handle_ = handle;
+    executor_.enqueue(this);
+}
+
+} // namespace soft_timer
+
+#endif /* STIMER_CORO_HPP_ */
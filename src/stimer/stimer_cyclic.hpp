@@ -0,0 +1,238 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_CYCLIC_HPP_
+#define STIMER_CYCLIC_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "stimer.hpp"
+
+
+// Largest number of minor frames in a hyperperiod. The dispatch table takes
+// 4 bytes of read-only data per frame, so the default caps it at 16 KB
+#ifndef STIMER_CONFIG_CYCLIC_MAX_FRAMES
+#define STIMER_CONFIG_CYCLIC_MAX_FRAMES 4096u
+#endif
+
+
+namespace soft_timer {
+
+// ----------------------------------------------------------- Private helpers
+
+namespace detail {
+
+constexpr uint64_t
+gcd(uint64_t a, uint64_t b)
+{
+    return (0 == b) ? a : gcd(b, a % b);
+}
+
+
+constexpr uint64_t
+lcm(uint64_t a, uint64_t b)
+{
+    // 0 if the result does not fit in 64 bits, which a real lcm of periods
+    // greater than 0 never is, and stays 0 through further lcm calls
+    return ((0 == a) || (0 == b)) ? 0
+        : ((a / gcd(a, b)) > (UINT64_MAX / b)) ? 0
+        : ((a / gcd(a, b)) * b);
+}
+
+
+inline unsigned int
+find_first_set_32(uint32_t x)
+{
+    // Index of the lowest set bit, x must not be 0
+#if defined(__GNUC__)
+    return static_cast<unsigned int>(__builtin_ctz(x));
+#else
+    unsigned int n = 0;
+    while (0 == (x & 1u)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+} // namespace detail
+
+
+// ----------------------------------------------------------- Cyclic schedule
+
+/**
+ * @brief Static cyclic schedule for a fixed set of periodic tasks
+ * @details The task periods are given in base ticks, highest priority task
+ *          first. At compile time this works out the minor frame (the
+ *          greatest common divisor of the periods), the hyperperiod (their
+ *          least common multiple), and a table holding, for every minor
+ *          frame in the hyperperiod, a bit mask of the tasks released in
+ *          it. All tasks are released together in frame 0. The table takes
+ *          4 bytes per minor frame, and is limited to
+ *          STIMER_CONFIG_CYCLIC_MAX_FRAMES frames.
+ *
+ * @tparam Periods Task periods in base ticks, each greater than 0
+ */
+template <uint32_t... Periods>
+struct CyclicSchedule {
+    static_assert((sizeof...(Periods) > 0) && (sizeof...(Periods) <= 32),
+                  "A cyclic schedule takes 1 to 32 tasks");
+    static_assert(((Periods > 0) && ...), "Task periods must be greater than 0");
+
+    static constexpr std::size_t task_count = sizeof...(Periods);
+    static constexpr std::array<uint32_t, task_count> periods = { Periods... };
+
+
+    // Minor frame and hyperperiod, in base ticks
+    static constexpr uint64_t minor_frame = []() {
+        uint64_t frame = 0;
+        for (uint32_t period : periods) {
+            frame = detail::gcd(frame, period);
+        }
+        return frame;
+    }();
+
+    static constexpr uint64_t hyperperiod = []() {
+        uint64_t length = 1;
+        for (uint32_t period : periods) {
+            length = detail::lcm(length, period);
+        }
+        return length;
+    }();
+
+    static_assert(0 != hyperperiod, "Hyperperiod does not fit in 64 bits");
+    static_assert(hyperperiod / minor_frame <= STIMER_CONFIG_CYCLIC_MAX_FRAMES,
+                  "Hyperperiod is more minor frames than STIMER_CONFIG_CYCLIC_MAX_FRAMES");
+
+    static constexpr std::size_t frame_count = static_cast<std::size_t>(hyperperiod / minor_frame);
+
+
+    // Tasks released in each minor frame, bit n for task n
+    static constexpr std::array<uint32_t, frame_count> frames = []() {
+        std::array<uint32_t, frame_count> table{};
+        for (std::size_t task = 0; task < task_count; ++task) {
+            for (uint64_t t = 0; t < hyperperiod; t += periods[task]) {
+                table[static_cast<std::size_t>(t / minor_frame)] |= static_cast<uint32_t>(1) << task;
+            }
+        }
+        return table;
+    }();
+};
+
+
+// ---------------------------------------------------------- Cyclic executive
+
+/**
+ * @brief Dispatches a CyclicSchedule from a single timer
+ * @details One timer expires every minor frame. Each poll that finds it
+ *          expired advances it, drift free, and calls the tasks released in
+ *          the frame, looked up in the schedule table, in priority order. If
+ *          polling falls behind, the missed frames are run back to back and
+ *          counted as overruns. There is no per task timer state.
+ *
+ * @tparam Schedule CyclicSchedule instance
+ */
+template <class Schedule>
+class CyclicExecutive {
+public:
+    typedef void (*task_fn)(void * hint);
+
+    /**
+     * @brief Creates the executive and starts frame 0 one minor frame from now
+     *
+     * @param ctx Timer context
+     * @param base_tick Duration of one base tick of the schedule periods
+     * @param tasks Task functions, in the order of the schedule periods
+     * @param hint Optional hint parameter passed to every task
+     */
+    template <class Rep, class Period>
+    CyclicExecutive(Context & ctx,
+                    std::chrono::duration<Rep, Period> base_tick,
+                    const std::array<task_fn, Schedule::task_count> & tasks,
+                    void * hint) noexcept
+        : timer_(ctx), tasks_(tasks), hint_(hint), frame_(0), overruns_(0)
+    {
+        timer_.expire_from_now(base_tick * Schedule::minor_frame);
+    }
+
+    /**
+     * @brief True if the timer was allocated
+     */
+    explicit operator bool() const noexcept { return static_cast<bool>(timer_); }
+
+    /**
+     * @brief Runs every minor frame that is due
+     *
+     * @return Number of minor frames run
+     */
+    uint32_t
+    poll() noexcept
+    {
+        uint32_t frames_run = 0;
+        while (timer_.is_expired()) {
+            timer_.advance();
+            dispatch(Schedule::frames[frame_]);
+            frame_ = (frame_ + 1 < Schedule::frame_count) ? (frame_ + 1) : 0;
+            ++frames_run;
+        }
+
+        if (frames_run > 1) {
+            overruns_ += frames_run - 1;
+        }
+        return frames_run;
+    }
+
+    /**
+     * @brief Index of the next minor frame to run
+     */
+    std::size_t frame() const noexcept { return frame_; }
+
+    /**
+     * @brief Number of minor frames that were run late
+     */
+    uint32_t overruns() const noexcept { return overruns_; }
+
+private:
+    void
+    dispatch(uint32_t released) noexcept
+    {
+        while (0 != released) {
+            unsigned int task = detail::find_first_set_32(released);
+            released &= released - 1;
+            tasks_[task](hint_);
+        }
+    }
+
+    Timer                                               timer_;
+    const std::array<task_fn, Schedule::task_count>     tasks_;
+    void *                                              hint_;
+    std::size_t                                         frame_;
+    uint32_t                                            overruns_;
+};
+
+} // namespace soft_timer
+
+#endif /* STIMER_CYCLIC_HPP_ */
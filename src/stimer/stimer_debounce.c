@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "stimer_debounce.h"
+
+// ----------------------------------------------------------- Public functions
+
+// ---------------------- Debounce
+
+void
+stimer_debounce_init(struct stimer_debounce * db, bool state)
+{
+    if (NULL != db) {
+        db->change_ticks = 0;
+        db->input = state;
+        db->state = state;
+    }
+}
+
+
+bool
+stimer_debounce_update(struct stimer_ctx * ctx,
+                       struct stimer_debounce * db,
+                       bool input,
+                       uint64_t hold_ticks)
+{
+    bool state = false;
+    if ((NULL != ctx) && (NULL != db)) {
+        uint64_t now = stimer_get_context_ticks(ctx);
+
+        if (input != db->input) {
+            db->input = input;
+            db->change_ticks = now;
+        }
+        if ((db->state != db->input) && ((now - db->change_ticks) >= hold_ticks)) {
+            db->state = db->input;
+        }
+        state = db->state;
+    }
+    return state;
+}
+
+
+// ---------------------- Throttle
+
+void
+stimer_throttle_init(struct stimer_throttle * th)
+{
+    if (NULL != th) {
+        th->allow_ticks = 0;
+        th->suppressed = 0;
+        th->is_started = false;
+    }
+}
+
+
+bool
+stimer_throttle_allow(struct stimer_ctx * ctx,
+                      struct stimer_throttle * th,
+                      uint64_t interval_ticks)
+{
+    bool is_allowed = false;
+    if ((NULL != ctx) && (NULL != th)) {
+        uint64_t now = stimer_get_context_ticks(ctx);
+
+        if (!th->is_started || ((now - th->allow_ticks) >= interval_ticks)) {
+            th->allow_ticks = now;
+            th->is_started = true;
+            is_allowed = true;
+        } else if (th->suppressed < UINT32_MAX) {
+            th->suppressed += 1;
+        }
+    }
+    return is_allowed;
+}
+
+
+uint32_t
+stimer_throttle_take_suppressed(struct stimer_throttle * th)
+{
+    uint32_t suppressed = 0;
+    if (NULL != th) {
+        suppressed = th->suppressed;
+        th->suppressed = 0;
+    }
+    return suppressed;
+}
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_DEBOUNCE_H_
+#define STIMER_DEBOUNCE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stimer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+// ------------------------------------------- Debounce and throttle structures
+
+/**
+ * Debounced input. Only the time of the last input change is kept, so an
+ * update is a clock read, a subtraction and a compare. It is never linked
+ * into the context.
+ */
+struct stimer_debounce {
+    uint64_t change_ticks;
+    bool input;
+    bool state;
+};
+
+
+/**
+ * Event throttle. Only the time of the last allowed event is kept, and a
+ * count of the events suppressed since. It is never linked into the context.
+ */
+struct stimer_throttle {
+    uint64_t allow_ticks;
+    uint32_t suppressed;
+    bool is_started;
+};
+
+
+// ------------------------------------------------------------------- Debounce
+
+/**
+ * @brief Initializes a debounced input
+ *
+ * @param db Debounced input
+ * @param state Initial state
+ */
+void
+stimer_debounce_init(struct stimer_debounce * db, bool state);
+
+
+/**
+ * @brief Updates a debounced input with a new raw input sample
+ * @details The debounced state follows the raw input once the input has held
+ *          the same value for hold_ticks. Convert the hold time once with
+ *          i.e. stimer_ms_to_ticks.
+ *
+ * @param ctx Timer context, used for the clock
+ * @param db Debounced input
+ * @param input Raw input
+ * @param hold_ticks get_time_fn ticks the input must hold a value for
+ * @return Debounced state
+ */
+bool
+stimer_debounce_update(struct stimer_ctx * ctx,
+                       struct stimer_debounce * db,
+                       bool input,
+                       uint64_t hold_ticks);
+
+
+// ------------------------------------------------------------------- Throttle
+
+/**
+ * @brief Initializes a throttle
+ *
+ * @param th Throttle
+ */
+void
+stimer_throttle_init(struct stimer_throttle * th);
+
+
+/**
+ * @brief Checks if an event is allowed through a throttle
+ * @details At most one event is allowed per interval_ticks, the first one
+ *          straight away. Events that are not allowed are counted, see
+ *          stimer_throttle_take_suppressed.
+ *
+ * @param ctx Timer context, used for the clock
+ * @param th Throttle
+ * @param interval_ticks Minimum get_time_fn ticks between allowed events
+ * @return true if the event is allowed, else false
+ */
+bool
+stimer_throttle_allow(struct stimer_ctx * ctx,
+                      struct stimer_throttle * th,
+                      uint64_t interval_ticks);
+
+
+/**
+ * @brief Gets and clears the number of events suppressed by a throttle
+ * @details i.e. to log how many messages were dropped along with the next
+ *          one that is allowed
+ *
+ * @param th Throttle
+ * @return Number of suppressed events
+ */
+uint32_t
+stimer_throttle_take_suppressed(struct stimer_throttle * th);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* STIMER_DEBOUNCE_H_ */
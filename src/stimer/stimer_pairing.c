@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "stimer_private.h"
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_PAIRING
+
+// ---------------------------------------------------------- Private functions
+
+static struct stimer *
+meld(struct stimer * a, struct stimer * b)
+{
+    // Both are roots. The later one becomes the first child of the other
+    if (NULL == a) {
+        return b;
+    }
+    if (NULL == b) {
+        return a;
+    }
+    if (b->index_deadline < a->index_deadline) {
+        struct stimer * t = a;
+        a = b;
+        b = t;
+    }
+
+    b->prev = a;
+    b->next = a->child;
+    if (NULL != a->child) {
+        a->child->prev = b;
+    }
+    a->child = b;
+    return a;
+}
+
+
+static struct stimer *
+merge_pairs(struct stimer * first)
+{
+    // Meld the siblings in pairs left to right, then the pairs right to
+    // left. The pairs are kept in a list linked through next, last pair first
+    struct stimer * pairs = NULL;
+    while (NULL != first) {
+        struct stimer * a = first;
+        struct stimer * b = a->next;
+
+        first = (NULL != b) ? b->next : NULL;
+        a->next = NULL;
+        a->prev = NULL;
+        if (NULL != b) {
+            b->next = NULL;
+            b->prev = NULL;
+        }
+
+        struct stimer * pair = meld(a, b);
+        pair->next = pairs;
+        pairs = pair;
+    }
+
+    struct stimer * root = NULL;
+    while (NULL != pairs) {
+        struct stimer * next = pairs->next;
+        pairs->next = NULL;
+        root = meld(root, pairs);
+        pairs = next;
+    }
+    return root;
+}
+
+
+static void
+cut_timer(struct stimer * ts)
+{
+    // Detach a non-root timer, with its subtree, from its parent
+    if (ts->prev->child == ts) {
+        ts->prev->child = ts->next;
+    } else {
+        ts->prev->next = ts->next;
+    }
+    if (NULL != ts->next) {
+        ts->next->prev = ts->prev;
+    }
+    ts->next = NULL;
+    ts->prev = NULL;
+}
+
+
+static struct stimer *
+pop_root(struct stimer_index * heap)
+{
+    struct stimer * ts = heap->root;
+    heap->root = merge_pairs(ts->child);
+    ts->child = NULL;
+    return ts;
+}
+
+
+static void
+settle_root(struct stimer_index * heap)
+{
+    // Rearming later only leaves the filed deadline early. Fix that up once
+    // the timer reaches the root, so the root deadline is exact
+    while (NULL != heap->root) {
+        uint64_t deadline = get_expire_deadline(heap->root);
+        if (deadline == heap->root->index_deadline) {
+            break;
+        }
+
+        struct stimer * ts = pop_root(heap);
+        ts->index_deadline = deadline;
+        heap->root = meld(heap->root, ts);
+    }
+}
+
+
+// ----------------------------------------------------------- Index functions
+
+bool
+stimer_index_init(struct stimer_ctx * ctx)
+{
+    ctx->index.root = NULL;
+    return true;
+}
+
+
+void
+stimer_index_deinit(struct stimer_ctx * ctx)
+{
+    // Nothing allocated
+    (void) ctx;
+}
+
+
+void
+stimer_index_insert(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    ts->index_deadline = get_expire_deadline(ts);
+    ts->child = NULL;
+    ts->next = NULL;
+    ts->prev = NULL;
+    ctx->index.root = meld(ctx->index.root, ts);
+}
+
+
+void
+stimer_index_remove(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    struct stimer_index * heap = &ctx->index;
+    if (heap->root == ts) {
+        (void) pop_root(heap);
+    } else {
+        cut_timer(ts);
+        heap->root = meld(heap->root, merge_pairs(ts->child));
+        ts->child = NULL;
+    }
+}
+
+
+void
+stimer_index_update(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    // Moving earlier is a decrease key: cut the subtree and meld it with the
+    // root. Moving later is left for settle_root
+    struct stimer_index * heap = &ctx->index;
+    uint64_t deadline = get_expire_deadline(ts);
+
+    if (deadline < ts->index_deadline) {
+        ts->index_deadline = deadline;
+        if (heap->root != ts) {
+            cut_timer(ts);
+            heap->root = meld(heap->root, ts);
+        }
+    }
+}
+
+
+struct stimer *
+stimer_index_pop_expired(struct stimer_ctx * ctx, uint64_t now)
+{
+    struct stimer_index * heap = &ctx->index;
+    struct stimer * ts = NULL;
+
+    settle_root(heap);
+    if ((NULL != heap->root) && (heap->root->index_deadline <= now)) {
+        ts = pop_root(heap);
+    }
+    return ts;
+}
+
+
+uint64_t
+stimer_index_next(struct stimer_ctx * ctx)
+{
+    struct stimer_index * heap = &ctx->index;
+
+    settle_root(heap);
+    return (NULL != heap->root) ? heap->root->index_deadline : UINT64_MAX;
+}
+
+
+struct stimer *
+stimer_index_first(struct stimer_ctx * ctx)
+{
+    return ctx->index.root;
+}
+
+#endif /* STIMER_CONFIG_BACKEND == STIMER_BACKEND_PAIRING */
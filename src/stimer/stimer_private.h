@@ -0,0 +1,452 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_PRIVATE_H_
+#define STIMER_PRIVATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stimer.h"
+#include "timermath/timermath.h"
+
+
+// -------------------------------------------------------------- Configuration
+
+// Pending timer index backends. Select one by defining STIMER_CONFIG_BACKEND
+// when building the library, i.e. -DSTIMER_CONFIG_BACKEND=STIMER_BACKEND_WHEEL
+#define STIMER_BACKEND_LIST             0
+#define STIMER_BACKEND_WHEEL            1
+#define STIMER_BACKEND_CALENDAR         2
+#define STIMER_BACKEND_RADIX            3
+#define STIMER_BACKEND_PAIRING          4
+#define STIMER_BACKEND_SORTED_LIST      5
+
+#ifndef STIMER_CONFIG_BACKEND
+#define STIMER_CONFIG_BACKEND           STIMER_BACKEND_LIST
+#endif
+
+// The list backend keeps pending timers in the context timer list, so there
+// is no separate index
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_LIST
+#define STIMER_HAS_INDEX                0
+#else
+#define STIMER_HAS_INDEX                1
+#endif
+
+
+// Timing wheel levels, each covering 64 times the range of the one below it.
+// Timers further out than the top level are kept in an overflow list
+#ifndef STIMER_CONFIG_WHEEL_LEVELS
+#define STIMER_CONFIG_WHEEL_LEVELS      4
+#endif
+
+#if (STIMER_CONFIG_WHEEL_LEVELS < 1) || (STIMER_CONFIG_WHEEL_LEVELS > 10)
+#error "STIMER_CONFIG_WHEEL_LEVELS must be from 1 to 10"
+#endif
+
+#define STIMER_WHEEL_BITS               6
+#define STIMER_WHEEL_SLOTS              (1u << STIMER_WHEEL_BITS)
+
+
+// Calendar queue bucket count bounds. The bucket array is resized between
+// them to keep about one timer per bucket
+#ifndef STIMER_CONFIG_CALENDAR_MIN_BUCKETS
+#define STIMER_CONFIG_CALENDAR_MIN_BUCKETS  16u
+#endif
+
+#ifndef STIMER_CONFIG_CALENDAR_MAX_BUCKETS
+#define STIMER_CONFIG_CALENDAR_MAX_BUCKETS  (1u << 20)
+#endif
+
+
+// Optional per timer features. Each one adds to every timer, so it is left
+// out unless enabled, i.e. -DSTIMER_CONFIG_EXPIRE_CALLBACK=1
+#ifndef STIMER_CONFIG_EXPIRE_CALLBACK
+#define STIMER_CONFIG_EXPIRE_CALLBACK   0
+#endif
+
+#ifndef STIMER_CONFIG_STATS
+#define STIMER_CONFIG_STATS             0
+#endif
+
+#ifndef STIMER_CONFIG_KICK
+#define STIMER_CONFIG_KICK              0
+#endif
+
+#ifndef STIMER_CONFIG_CLASSES
+#define STIMER_CONFIG_CLASSES           0
+#endif
+
+
+// -------------------------------------------------------------- Private types
+
+enum stimer_location {
+    STIMER_IN_LIST,
+    STIMER_IN_CLASS,
+    STIMER_IN_INDEX
+};
+
+
+struct tick_rate {
+    // Ticks per unit, split into whole ticks and a 32 bit binary fraction
+    uint32_t                            whole;
+    uint32_t                            fraction;
+    uint32_t                            unit_ns;
+};
+
+
+struct stimer_class {
+    // Context
+    struct stimer_ctx *                 ctx;
+
+
+    // Context class linked list
+    struct stimer_class *               next;
+
+
+    // Pending timers, in expiration order
+    struct stimer *                     head;
+    struct stimer *                     tail;
+
+
+    // Expire period, rounded up to whole ticks, and how far it was rounded
+    uint64_t                            interval_ticks;
+    uint32_t                            interval_excess_ns;
+};
+
+
+struct stimer {
+    // Context
+    struct stimer_ctx *                 ctx;
+
+
+    // Linked list. The timer is either in the context timer list, queued in
+    // its interval class, or in the pending timer index. The index backend
+    // owns next and prev while the timer is in the index
+    struct stimer *                     next;
+    struct stimer *                     prev;
+#if STIMER_CONFIG_CLASSES
+    struct stimer_class *               cls;
+#endif
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_WHEEL
+    // Wheel slot or list the timer is in
+    struct stimer **                    wheel_list;
+#elif (STIMER_CONFIG_BACKEND == STIMER_BACKEND_CALENDAR) || \
+      (STIMER_CONFIG_BACKEND == STIMER_BACKEND_RADIX)
+    // Deadline the timer is filed under in the index
+    uint64_t                            index_deadline;
+#elif STIMER_CONFIG_BACKEND == STIMER_BACKEND_PAIRING
+    // Deadline the timer is filed under in the heap, which may be earlier
+    // than the actual one, and its first child. next is the next sibling,
+    // and prev the previous sibling or the parent of a first child
+    uint64_t                            index_deadline;
+    struct stimer *                     child;
+#endif
+
+
+    // Context time at which the elapsed time was 0
+    uint64_t                            start_ticks;
+
+
+#if STIMER_CONFIG_KICK
+    // Context time of the last stimer_kick, or of when the timer was started
+    uint64_t                            kick_ticks;
+#endif
+
+
+    // Expire period, rounded up to whole ticks. Elapsed ticks at which the
+    // timer expires, which is interval_ticks, or one less when the elapsed
+    // remainder makes up for the rounding. Elapsed time in whole ticks
+    uint64_t                            interval_ticks;
+    uint64_t                            expire_ticks;
+    uint64_t                            elapsed_ticks;
+
+
+    // How far the expire period was rounded up, and the elapsed remainder
+    // left by stimer_advance. Kept next to the flags below so they pack
+    uint32_t                            interval_excess_ns;
+    uint32_t                            elapsed_excess_ns;
+
+
+    // Where the timer is linked, and its state. is_expire_seen is set once
+    // an execute pass has seen the current expiration
+    enum stimer_location                location;
+    bool                                is_running;
+    bool                                is_expiring;
+    bool                                is_expire_seen;
+#if STIMER_CONFIG_STATS
+    bool                                is_jitter_stats;
+#endif
+
+
+#if STIMER_CONFIG_EXPIRE_CALLBACK
+    // Expiration callback, and whether the current expiration was reported
+    stimer_expire_fn                    expire_fn;
+    void *                              expire_hint;
+    bool                                is_expire_reported;
+#endif
+
+
+#if STIMER_CONFIG_STATS
+    // Statistics, or NULL. They record the elapsed time of each start/stop
+    // cycle, or with is_jitter_stats how late each expiration was advanced
+    // from. A timer is either a stopwatch or periodic, so one pointer does
+    struct stimer_stats *               stats;
+#endif
+};
+
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_WHEEL
+struct stimer_index {
+    // Wheel time. Every timer in the wheel expires at or after this
+    uint64_t                            now;
+
+
+    // Slots, level by level, and a bitmap per level of the slots that are
+    // not empty
+    struct stimer *                     slots[STIMER_CONFIG_WHEEL_LEVELS *
+                                              STIMER_WHEEL_SLOTS];
+    uint64_t                            occupied[STIMER_CONFIG_WHEEL_LEVELS];
+
+
+    // Timers beyond the top level, and the earliest expiration among them
+    struct stimer *                     overflow;
+    uint64_t                            overflow_next;
+
+
+    // Timers the wheel has passed, waiting to be popped
+    struct stimer *                     expired;
+};
+#elif STIMER_CONFIG_BACKEND == STIMER_BACKEND_CALENDAR
+struct stimer_index {
+    // Buckets, each a sorted list of the timers whose deadline falls in it
+    // modulo the bucket count. Allocated on the heap and resized with the
+    // number of timers
+    struct stimer **                    buckets;
+    uint32_t                            bucket_count;
+    unsigned int                        width_shift;
+    uint32_t                            size;
+
+
+    // Every deadline in the calendar is at or after this
+    uint64_t                            last;
+
+
+    // Cached earliest timer, or NULL if it needs a search
+    struct stimer *                     min;
+};
+#elif STIMER_CONFIG_BACKEND == STIMER_BACKEND_RADIX
+struct stimer_index {
+    // Deadline of the last timer popped. No deadline in the heap is earlier
+    uint64_t                            last;
+
+
+    // Bucket 0 holds the deadlines equal to last, and bucket b the ones whose
+    // highest bit that differs from last is bit b - 1. A bitmap of the non
+    // empty buckets 1 to 64
+    struct stimer *                     buckets[65];
+    uint64_t                            occupied;
+
+
+    // Cached earliest timer, or NULL if it needs a search
+    struct stimer *                     min;
+};
+#elif STIMER_CONFIG_BACKEND == STIMER_BACKEND_PAIRING
+struct stimer_index {
+    // Heap root, the timer with the earliest filed deadline
+    struct stimer *                     root;
+};
+#elif STIMER_CONFIG_BACKEND == STIMER_BACKEND_SORTED_LIST
+struct stimer_index {
+    // Timers sorted by deadline, earliest first
+    struct stimer *                     head;
+};
+#endif
+
+
+struct stimer_ctx {
+    // Timer linked list root
+    struct stimer *                     root;
+
+
+    // Next timer to visit in a budgeted execute pass
+    struct stimer *                     cursor;
+
+
+#if STIMER_CONFIG_CLASSES
+    // Interval class linked list root
+    struct stimer_class *               classes;
+#endif
+
+
+#if STIMER_HAS_INDEX
+    // Pending timer index
+    struct stimer_index                 index;
+#endif
+
+
+    // Timer math
+    struct tm_math                      tm;
+    uint32_t                            ns_per_count;
+    struct tick_rate                    ticks_per_s;
+    struct tick_rate                    ticks_per_ms;
+    struct tick_rate                    ticks_per_us;
+    struct tick_rate                    ticks_per_ns;
+
+
+    // Time function
+    stimer_get_time_fn                  get_time_fn;
+    void *                              hint;
+
+
+    // Most recent get_time_fn value extended to 64 bits so it never rolls
+    // over, and the value itself
+    uint64_t                            now_ticks;
+    uint32_t                            now_time;
+    uint32_t                            max_time;
+
+
+    // Alarm function, and the alarm time it was last called with
+    stimer_set_alarm_fn                 set_alarm_fn;
+    void *                              alarm_hint;
+    uint32_t                            alarm_time;
+    uint32_t                            alarm_horizon;
+
+
+    // Earliest expiration seen so far in the current execute pass
+    uint32_t                            pass_alarm_time;
+    bool                                is_alarm_set;
+};
+
+
+// ---------------------------------------------------------- Private functions
+
+static inline uint64_t
+get_expire_deadline(struct stimer * ts)
+{
+    return ts->start_ticks + ts->expire_ticks;
+}
+
+
+static inline unsigned int
+find_first_set_64(uint64_t x)
+{
+    // Index of the lowest set bit, x must not be 0
+#if defined(__GNUC__)
+    return (unsigned int) __builtin_ctzll(x);
+#else
+    unsigned int n = 0;
+    if (0 == (x & 0xFFFFFFFFu)) { n += 32; x >>= 32; }
+    if (0 == (x & 0xFFFFu))     { n += 16; x >>= 16; }
+    if (0 == (x & 0xFFu))       { n += 8;  x >>= 8; }
+    if (0 == (x & 0xFu))        { n += 4;  x >>= 4; }
+    if (0 == (x & 0x3u))        { n += 2;  x >>= 2; }
+    if (0 == (x & 0x1u))        { n += 1; }
+    return n;
+#endif
+}
+
+
+static inline unsigned int
+find_last_set_64(uint64_t x)
+{
+    // Index of the highest set bit, x must not be 0
+#if defined(__GNUC__)
+    return 63u - (unsigned int) __builtin_clzll(x);
+#else
+    unsigned int n = 0;
+    if (0 != (x >> 32)) { n += 32; x >>= 32; }
+    if (0 != (x >> 16)) { n += 16; x >>= 16; }
+    if (0 != (x >> 8))  { n += 8;  x >>= 8; }
+    if (0 != (x >> 4))  { n += 4;  x >>= 4; }
+    if (0 != (x >> 2))  { n += 2;  x >>= 2; }
+    if (0 != (x >> 1))  { n += 1; }
+    return n;
+#endif
+}
+
+
+// ---------------------------------------------------- Pending timer index API
+
+#if STIMER_HAS_INDEX
+
+/**
+ * Initializes the index of a new context. Returns false if out of memory
+ */
+bool
+stimer_index_init(struct stimer_ctx * ctx);
+
+
+/**
+ * Releases anything the index allocated. The index must be empty
+ */
+void
+stimer_index_deinit(struct stimer_ctx * ctx);
+
+
+/**
+ * Adds a pending timer to the index
+ */
+void
+stimer_index_insert(struct stimer_ctx * ctx, struct stimer * ts);
+
+
+/**
+ * Removes a timer from the index
+ */
+void
+stimer_index_remove(struct stimer_ctx * ctx, struct stimer * ts);
+
+
+/**
+ * Called when the expiration of a timer in the index has moved
+ */
+void
+stimer_index_update(struct stimer_ctx * ctx, struct stimer * ts);
+
+
+/**
+ * Removes and returns a timer that expired at or before now, or NULL
+ */
+struct stimer *
+stimer_index_pop_expired(struct stimer_ctx * ctx, uint64_t now);
+
+
+/**
+ * Returns a time at or before the earliest expiration in the index, or
+ * UINT64_MAX if the index is empty
+ */
+uint64_t
+stimer_index_next(struct stimer_ctx * ctx);
+
+
+/**
+ * Returns any timer in the index, or NULL if it is empty
+ */
+struct stimer *
+stimer_index_first(struct stimer_ctx * ctx);
+
+#endif /* STIMER_HAS_INDEX */
+
+#endif /* STIMER_PRIVATE_H_ */
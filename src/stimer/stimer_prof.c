@@ -0,0 +1,300 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "stimer_prof.h"
+
+// -------------------------------------------------------------- Private types
+
+// Node index for no node. Node 0 is the root of the call tree
+#define NO_NODE                         UINT16_MAX
+
+
+struct prof_node {
+    // Scope name, and the call tree links
+    const char *                        name;
+    uint16_t                            parent;
+    uint16_t                            first_child;
+    uint16_t                            last_child;
+    uint16_t                            next_sibling;
+
+
+    // Profile
+    uint32_t                            calls;
+    uint64_t                            inclusive_ticks;
+    uint64_t                            child_ticks;
+};
+
+
+struct prof_frame {
+    uint16_t                            node;
+    uint64_t                            start_ticks;
+};
+
+
+struct stimer_prof {
+    // Timer context
+    struct stimer_ctx *                 ctx;
+
+
+    // Call tree nodes, and a hash table of node indexes keyed on the parent
+    // and the name. Open addressing with linear probing, at most half full
+    struct prof_node *                  nodes;
+    uint16_t                            node_count;
+    uint16_t                            max_nodes;
+    uint16_t *                          table;
+    uint32_t                            table_mask;
+
+
+    // Entered scopes. Scopes entered past the stack or node table are only
+    // counted, so exits still match
+    struct prof_frame *                 stack;
+    uint16_t                            depth;
+    uint16_t                            max_depth;
+    uint32_t                            dropped_depth;
+    uint32_t                            dropped;
+};
+
+
+// ---------------------------------------------------------- Private functions
+
+static inline uint32_t
+hash_scope(uint16_t parent, const char * name)
+{
+    uint32_t h = (uint32_t) (uintptr_t) name ^ ((uint32_t) parent << 16);
+    return h * 2654435761u;
+}
+
+
+static void
+init_node(struct prof_node * node, uint16_t parent, const char * name)
+{
+    node->name = name;
+    node->parent = parent;
+    node->first_child = NO_NODE;
+    node->last_child = NO_NODE;
+    node->next_sibling = NO_NODE;
+    node->calls = 0;
+    node->inclusive_ticks = 0;
+    node->child_ticks = 0;
+}
+
+
+static uint16_t
+find_or_add_node(struct stimer_prof * prof, uint16_t parent, const char * name)
+{
+    uint32_t i = hash_scope(parent, name) & prof->table_mask;
+
+    for (;;) {
+        uint16_t index = prof->table[i];
+        if (NO_NODE == index) {
+            break;
+        }
+        if ((prof->nodes[index].name == name) && (prof->nodes[index].parent == parent)) {
+            return index;
+        }
+        i = (i + 1u) & prof->table_mask;
+    }
+
+    if (prof->node_count >= prof->max_nodes) {
+        return NO_NODE;
+    }
+
+    uint16_t index = prof->node_count++;
+    struct prof_node * p = &prof->nodes[parent];
+    init_node(&prof->nodes[index], parent, name);
+    if (NO_NODE != p->last_child) {
+        prof->nodes[p->last_child].next_sibling = index;
+    } else {
+        p->first_child = index;
+    }
+    p->last_child = index;
+
+    prof->table[i] = index;
+    return index;
+}
+
+
+// ----------------------------------------------------------- Public functions
+
+struct stimer_prof *
+stimer_alloc_prof(struct stimer_ctx * ctx, uint16_t max_scopes, uint16_t max_depth)
+{
+    struct stimer_prof * prof = NULL;
+    if ((NULL != ctx) && (0 != max_scopes) && (max_scopes < NO_NODE)
+            && (0 != max_depth)) {
+        prof = (struct stimer_prof *) malloc(sizeof(struct stimer_prof));
+    }
+
+    if (NULL != prof) {
+        // One more node for the root, and a table at least twice the nodes
+        uint32_t table_size = 1;
+        while (table_size < (2u * ((uint32_t) max_scopes + 1u))) {
+            table_size <<= 1;
+        }
+
+        prof->ctx = ctx;
+        prof->nodes = (struct prof_node *)
+            malloc(((size_t) max_scopes + 1u) * sizeof(struct prof_node));
+        prof->table = (uint16_t *) malloc(table_size * sizeof(uint16_t));
+        prof->stack = (struct prof_frame *)
+            malloc((size_t) max_depth * sizeof(struct prof_frame));
+
+        if ((NULL == prof->nodes) || (NULL == prof->table) || (NULL == prof->stack)) {
+            stimer_free_prof(prof);
+            prof = NULL;
+        } else {
+            uint32_t i;
+            for (i = 0; i < table_size; ++i) {
+                prof->table[i] = NO_NODE;
+            }
+            prof->table_mask = table_size - 1u;
+
+            init_node(&prof->nodes[0], NO_NODE, NULL);
+            prof->node_count = 1;
+            prof->max_nodes = (uint16_t) (max_scopes + 1u);
+
+            prof->depth = 0;
+            prof->max_depth = max_depth;
+            prof->dropped_depth = 0;
+            prof->dropped = 0;
+        }
+    }
+
+    return prof;
+}
+
+
+void
+stimer_free_prof(struct stimer_prof * prof)
+{
+    if (NULL != prof) {
+        free(prof->stack);
+        free(prof->table);
+        free(prof->nodes);
+        free(prof);
+    }
+}
+
+
+void
+stimer_prof_enter(struct stimer_prof * prof, const char * name)
+{
+    if (NULL != prof) {
+        uint16_t node = NO_NODE;
+        if ((0 == prof->dropped_depth) && (prof->depth < prof->max_depth)) {
+            uint16_t parent = (0 != prof->depth) ? prof->stack[prof->depth - 1u].node : 0u;
+            node = find_or_add_node(prof, parent, name);
+        }
+
+        if (NO_NODE != node) {
+            struct prof_frame * frame = &prof->stack[prof->depth++];
+            frame->node = node;
+            frame->start_ticks = stimer_get_context_ticks(prof->ctx);
+        } else {
+            prof->dropped_depth += 1;
+            prof->dropped += 1;
+        }
+    }
+}
+
+
+void
+stimer_prof_exit(struct stimer_prof * prof)
+{
+    if (NULL != prof) {
+        if (0 != prof->dropped_depth) {
+            prof->dropped_depth -= 1;
+        } else if (0 != prof->depth) {
+            struct prof_frame * frame = &prof->stack[--prof->depth];
+            struct prof_node * node = &prof->nodes[frame->node];
+            uint64_t ticks = stimer_get_context_ticks(prof->ctx) - frame->start_ticks;
+
+            node->calls += 1;
+            node->inclusive_ticks += ticks;
+            prof->nodes[node->parent].child_ticks += ticks;
+        }
+    }
+}
+
+
+void
+stimer_prof_visit(struct stimer_prof * prof, void * hint, stimer_prof_visit_fn visit_fn)
+{
+    if ((NULL != prof) && (NULL != visit_fn)) {
+        struct stimer_prof_record record;
+        uint32_t depth = 0;
+        uint16_t index = prof->nodes[0].first_child;
+
+        // Depth first walk over the child and sibling links, no recursion
+        while (NO_NODE != index) {
+            struct prof_node * node = &prof->nodes[index];
+
+            record.name = node->name;
+            record.depth = depth;
+            record.calls = node->calls;
+            record.inclusive_ticks = node->inclusive_ticks;
+            record.exclusive_ticks = (node->inclusive_ticks > node->child_ticks) ?
+                (node->inclusive_ticks - node->child_ticks) : 0;
+            visit_fn(hint, &record);
+
+            if (NO_NODE != node->first_child) {
+                index = node->first_child;
+                ++depth;
+            } else {
+                while ((0 != index) && (NO_NODE == prof->nodes[index].next_sibling)) {
+                    index = prof->nodes[index].parent;
+                    --depth;
+                }
+                index = (0 != index) ? prof->nodes[index].next_sibling : NO_NODE;
+            }
+        }
+    }
+}
+
+
+void
+stimer_prof_reset(struct stimer_prof * prof)
+{
+    if (NULL != prof) {
+        uint16_t i;
+        for (i = 0; i < prof->node_count; ++i) {
+            prof->nodes[i].calls = 0;
+            prof->nodes[i].inclusive_ticks = 0;
+            prof->nodes[i].child_ticks = 0;
+        }
+        prof->dropped = 0;
+    }
+}
+
+
+uint32_t
+stimer_prof_get_dropped(struct stimer_prof * prof)
+{
+    uint32_t dropped = 0;
+    if (NULL != prof) {
+        dropped = prof->dropped;
+    }
+    return dropped;
+}
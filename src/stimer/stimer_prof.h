@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_PROF_H_
+#define STIMER_PROF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stimer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+// -------------------------------------------------------- Profiler structures
+
+// ---------------------- Profiler
+struct stimer_prof;
+
+
+/**
+ * Profile of one scope in the call tree, in get_time_fn ticks
+ */
+struct stimer_prof_record {
+    const char * name;
+    uint32_t depth;
+    uint32_t calls;
+    uint64_t inclusive_ticks;
+    uint64_t exclusive_ticks;
+};
+
+
+/**
+ * @brief Function pointer prototype for visiting the call tree
+ *
+ * @param hint Hint parameter given to stimer_prof_visit
+ * @param record Profile of a scope, only valid for the call
+ */
+typedef void (*stimer_prof_visit_fn)(void * hint,
+                                     const struct stimer_prof_record * record);
+
+
+// ------------------------------------------------------------------- Profiler
+
+/**
+ * @brief Allocates a call tree profiler on the heap
+ * @details The profiler keeps a stack of entered scopes, and a fixed size
+ *          table of call tree nodes. A node is a scope name under a parent
+ *          node, so the same scope entered from two places is profiled
+ *          separately. Nodes are found through a hash table, so entering and
+ *          exiting a scope is constant time and never allocates. Time is
+ *          read from the context clock, no timers are used.
+ *
+ * @param ctx Timer context, used for the clock
+ * @param max_scopes Maximum number of call tree nodes, at most 65534
+ * @param max_depth Maximum scope nesting depth
+ * @return Profiler, or NULL on an error
+ */
+struct stimer_prof *
+stimer_alloc_prof(struct stimer_ctx * ctx, uint16_t max_scopes, uint16_t max_depth);
+
+
+/**
+ * @brief Deallocates a profiler
+ *
+ * @param prof Profiler to free
+ */
+void
+stimer_free_prof(struct stimer_prof * prof);
+
+
+/**
+ * @brief Enters a scope
+ * @details Scope names are compared by pointer, not by content, so use string
+ *          literals or other strings that live as long as the profiler. A
+ *          scope that does not fit in the node table or is nested too deep
+ *          is not profiled, and its time counts towards the exclusive time
+ *          of its parent. See stimer_prof_get_dropped.
+ *
+ * @param prof Profiler
+ * @param name Scope name
+ */
+void
+stimer_prof_enter(struct stimer_prof * prof, const char * name);
+
+
+/**
+ * @brief Exits the most recently entered scope
+ *
+ * @param prof Profiler
+ */
+void
+stimer_prof_exit(struct stimer_prof * prof);
+
+
+/**
+ * @brief Visits every scope in the call tree
+ * @details Scopes are visited depth first, each parent before its children
+ *          and children in the order they were first entered. Only scopes
+ *          that have been exited are counted.
+ *
+ * @param prof Profiler
+ * @param hint Optional hint parameter for the visit_fn function
+ * @param visit_fn Visit function pointer
+ */
+void
+stimer_prof_visit(struct stimer_prof * prof, void * hint, stimer_prof_visit_fn visit_fn);
+
+
+/**
+ * @brief Clears the profile counts, keeping the call tree
+ *
+ * @param prof Profiler
+ */
+void
+stimer_prof_reset(struct stimer_prof * prof);
+
+
+/**
+ * @brief Gets the number of scope entries that were not profiled
+ *
+ * @param prof Profiler
+ * @return Number of dropped scope entries
+ */
+uint32_t
+stimer_prof_get_dropped(struct stimer_prof * prof);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* STIMER_PROF_H_ */
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_PT_H_
+#define STIMER_PT_H_
+
+#include "stimer.h"
+
+
+// ---------------------------------------------------------------- Wait macros
+// These wait on a struct stimer_deadline, which is a plain value meant to be
+// embedded in the protothread state next to its struct pt. It is not linked
+// into the context, so stimer_execute_context never visits it, and any number
+// of protothreads can wait without adding to the cost of an execute pass.
+//
+// The macros expand to PT_WAIT_UNTIL, so the protothreads header must be
+// included before they are used
+
+/**
+ * @brief Blocks the protothread until the deadline passes
+ */
+#define STIMER_PT_WAIT_EXPIRED(pt, dl)                                          \
+    PT_WAIT_UNTIL((pt), stimer_deadline_is_expired(dl))
+
+
+/**
+ * @brief Blocks the protothread for a duration
+ */
+#define STIMER_PT_WAIT(pt, ctx, dl, t)                                          \
+    do {                                                                        \
+        stimer_deadline_from_now((dl), (ctx), (t));                             \
+        STIMER_PT_WAIT_EXPIRED((pt), (dl));                                     \
+    } while (0)
+
+
+/**
+ * @brief Blocks the protothread for a number of milliseconds
+ */
+#define STIMER_PT_WAIT_MS(pt, ctx, dl, ms)                                      \
+    do {                                                                        \
+        stimer_deadline_from_now_ms((dl), (ctx), (ms));                         \
+        STIMER_PT_WAIT_EXPIRED((pt), (dl));                                     \
+    } while (0)
+
+
+/**
+ * @brief Blocks the protothread for a number of microseconds
+ */
+#define STIMER_PT_WAIT_US(pt, ctx, dl, us)                                      \
+    do {                                                                        \
+        stimer_deadline_from_now_us((dl), (ctx), (us));                         \
+        STIMER_PT_WAIT_EXPIRED((pt), (dl));                                     \
+    } while (0)
+
+
+/**
+ * @brief Blocks the protothread until the next period, for steady periodic
+ *        loops. The deadline must be set once before the loop
+ */
+#define STIMER_PT_WAIT_PERIOD_MS(pt, dl, ms)                                    \
+    do {                                                                        \
+        stimer_deadline_advance_ms((dl), (ms));                                 \
+        STIMER_PT_WAIT_EXPIRED((pt), (dl));                                     \
+    } while (0)
+
+
+/**
+ * @brief Blocks the protothread until a condition is true or a number of
+ *        milliseconds pass. Check the deadline afterwards to tell which
+ */
+#define STIMER_PT_WAIT_UNTIL_MS(pt, ctx, dl, ms, condition)                     \
+    do {                                                                        \
+        stimer_deadline_from_now_ms((dl), (ctx), (ms));                         \
+        PT_WAIT_UNTIL((pt), (condition) || stimer_deadline_is_expired(dl));     \
+    } while (0)
+
+#endif /* STIMER_PT_H_ */
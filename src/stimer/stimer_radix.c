@@ -0,0 +1,258 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "stimer_private.h"
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_RADIX
+
+// ---------------------------------------------------------- Private functions
+
+static inline unsigned int
+get_bucket_index(struct stimer_index * heap, uint64_t deadline)
+{
+    return (deadline == heap->last) ? 0 : (find_last_set_64(deadline ^ heap->last) + 1);
+}
+
+
+static void
+file_timer(struct stimer_index * heap, struct stimer * ts)
+{
+    // The bucket only depends on the bits shared with last, which stay the
+    // same for a timer until its own bucket is redistributed
+    unsigned int b = get_bucket_index(heap, ts->index_deadline);
+
+    ts->prev = NULL;
+    ts->next = heap->buckets[b];
+    if (NULL != ts->next) {
+        ts->next->prev = ts;
+    }
+    heap->buckets[b] = ts;
+
+    if (0 != b) {
+        heap->occupied |= (uint64_t) 1 << (b - 1);
+    }
+    if ((NULL != heap->min) && (ts->index_deadline < heap->min->index_deadline)) {
+        heap->min = ts;
+    }
+}
+
+
+static void
+unfile_timer(struct stimer_index * heap, struct stimer * ts)
+{
+    unsigned int b = get_bucket_index(heap, ts->index_deadline);
+
+    if (NULL != ts->prev) {
+        ts->prev->next = ts->next;
+    } else {
+        heap->buckets[b] = ts->next;
+    }
+    if (NULL != ts->next) {
+        ts->next->prev = ts->prev;
+    }
+    ts->next = NULL;
+    ts->prev = NULL;
+
+    if ((0 != b) && (NULL == heap->buckets[b])) {
+        heap->occupied &= ~((uint64_t) 1 << (b - 1));
+    }
+    if (heap->min == ts) {
+        heap->min = NULL;
+    }
+}
+
+
+static inline unsigned int
+get_first_bucket(struct stimer_index * heap)
+{
+    // Only valid if the heap is not empty
+    return (NULL != heap->buckets[0]) ? 0 : (find_first_set_64(heap->occupied) + 1);
+}
+
+
+static void
+redistribute_bucket(struct stimer_index * heap, unsigned int b, uint64_t last)
+{
+    // Any last between the current one and the earliest deadline of the
+    // first bucket keeps the other buckets valid. The timers of the first
+    // bucket only move to lower buckets, so each one is moved a bounded
+    // number of times
+    struct stimer * ts = heap->buckets[b];
+    heap->buckets[b] = NULL;
+    heap->occupied &= ~((uint64_t) 1 << (b - 1));
+    heap->last = last;
+
+    while (NULL != ts) {
+        struct stimer * next = ts->next;
+        file_timer(heap, ts);
+        ts = next;
+    }
+}
+
+
+static struct stimer *
+find_min(struct stimer_index * heap, uint64_t now)
+{
+    // The earliest timer is in the first non-empty bucket. Every deadline in
+    // bucket 0 is equal to last, so its head will do. Any other bucket is
+    // searched, which only happens after the earliest timer left, and also
+    // moves last up as far as timers armed from now allow, so the next
+    // search is shorter
+    if ((NULL == heap->min) && ((NULL != heap->buckets[0]) || (0 != heap->occupied))) {
+        unsigned int b = get_first_bucket(heap);
+        struct stimer * min = heap->buckets[b];
+        heap->min = min;
+        if (0 != b) {
+            struct stimer * ts;
+            for (ts = min->next; NULL != ts; ts = ts->next) {
+                if (ts->index_deadline < min->index_deadline) {
+                    min = ts;
+                }
+            }
+
+            heap->min = min;
+            uint64_t last = (min->index_deadline < now) ? min->index_deadline : now;
+            if (last > heap->last) {
+                redistribute_bucket(heap, b, last);
+            }
+        }
+    }
+    return heap->min;
+}
+
+
+static void
+pop_min(struct stimer_index * heap, struct stimer * min)
+{
+    unsigned int b = get_bucket_index(heap, min->index_deadline);
+    unfile_timer(heap, min);
+
+    // Move last up to the popped deadline. Only the bucket it came from needs
+    // redistributing, and all of its timers move to lower buckets. Anything
+    // left in bucket 0 then shares the popped deadline, and is the earliest
+    if (0 != b) {
+        redistribute_bucket(heap, b, min->index_deadline);
+    }
+    heap->min = heap->buckets[0];
+}
+
+
+static void
+insert_timer(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    // Deadlines are monotone, except for a timer advanced while it is
+    // overdue. Clamping it to last still expires it on the next pass
+    struct stimer_index * heap = &ctx->index;
+    uint64_t deadline = get_expire_deadline(ts);
+
+    ts->index_deadline = (deadline > heap->last) ? deadline : heap->last;
+    file_timer(heap, ts);
+}
+
+
+// ----------------------------------------------------------- Index functions
+
+bool
+stimer_index_init(struct stimer_ctx * ctx)
+{
+    struct stimer_index * heap = &ctx->index;
+    unsigned int i;
+
+    heap->last = ctx->now_ticks;
+    for (i = 0; i < 65; ++i) {
+        heap->buckets[i] = NULL;
+    }
+    heap->occupied = 0;
+    heap->min = NULL;
+    return true;
+}
+
+
+void
+stimer_index_deinit(struct stimer_ctx * ctx)
+{
+    // Nothing allocated
+    (void) ctx;
+}
+
+
+void
+stimer_index_insert(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    insert_timer(ctx, ts);
+}
+
+
+void
+stimer_index_remove(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    unfile_timer(&ctx->index, ts);
+}
+
+
+void
+stimer_index_update(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    // An earliest timer moved earlier is still the earliest, and needs no
+    // search to find again
+    struct stimer_index * heap = &ctx->index;
+    bool is_min = (heap->min == ts);
+    uint64_t deadline = ts->index_deadline;
+
+    unfile_timer(heap, ts);
+    insert_timer(ctx, ts);
+    if (is_min && (ts->index_deadline <= deadline)) {
+        heap->min = ts;
+    }
+}
+
+
+struct stimer *
+stimer_index_pop_expired(struct stimer_ctx * ctx, uint64_t now)
+{
+    struct stimer * ts = find_min(&ctx->index, ctx->now_ticks);
+    if ((NULL != ts) && (ts->index_deadline <= now)) {
+        pop_min(&ctx->index, ts);
+    } else {
+        ts = NULL;
+    }
+    return ts;
+}
+
+
+uint64_t
+stimer_index_next(struct stimer_ctx * ctx)
+{
+    struct stimer * ts = find_min(&ctx->index, ctx->now_ticks);
+    return (NULL != ts) ? ts->index_deadline : UINT64_MAX;
+}
+
+
+struct stimer *
+stimer_index_first(struct stimer_ctx * ctx)
+{
+    return find_min(&ctx->index, ctx->now_ticks);
+}
+
+#endif /* STIMER_CONFIG_BACKEND == STIMER_BACKEND_RADIX */
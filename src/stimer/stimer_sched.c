@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "stimer_sched.h"
+#include "stimer_private.h"
+
+// ------------------------------------------------------------- Private types
+
+struct stimer_sched {
+    // Timer context
+    struct stimer_ctx *                 ctx;
+
+
+    // All tasks
+    struct stimer_task *                tasks;
+
+
+    // Ready tasks, a FIFO queue per priority and a bitmap of the non-empty
+    // queues
+    struct stimer_task *                ready_head[STIMER_SCHED_PRIORITIES];
+    struct stimer_task *                ready_tail[STIMER_SCHED_PRIORITIES];
+    uint32_t                            ready;
+};
+
+
+struct stimer_task {
+    // Scheduler, and its task linked list
+    struct stimer_sched *               sched;
+    struct stimer_task *                next;
+    struct stimer_task *                prev;
+
+
+    // Ready queue linked list
+    struct stimer_task *                ready_next;
+    struct stimer_task *                ready_prev;
+    bool                                is_ready;
+
+
+    // Release timer
+    struct stimer *                     timer;
+    bool                                is_periodic;
+
+
+    // Task function
+    stimer_task_fn                      task_fn;
+    void *                              hint;
+    uint8_t                             priority;
+};
+
+
+// ---------------------------------------------------------- Private functions
+
+static void
+make_ready(struct stimer_task * task)
+{
+    struct stimer_sched * sched = task->sched;
+    uint8_t priority = task->priority;
+
+    if (!task->is_ready) {
+        task->ready_next = NULL;
+        task->ready_prev = sched->ready_tail[priority];
+        if (NULL != task->ready_prev) {
+            task->ready_prev->ready_next = task;
+        } else {
+            sched->ready_head[priority] = task;
+        }
+        sched->ready_tail[priority] = task;
+        sched->ready |= (uint32_t) 1 << priority;
+        task->is_ready = true;
+    }
+}
+
+
+static void
+make_unready(struct stimer_task * task)
+{
+    struct stimer_sched * sched = task->sched;
+    uint8_t priority = task->priority;
+
+    if (task->is_ready) {
+        if (NULL != task->ready_prev) {
+            task->ready_prev->ready_next = task->ready_next;
+        } else {
+            sched->ready_head[priority] = task->ready_next;
+        }
+        if (NULL != task->ready_next) {
+            task->ready_next->ready_prev = task->ready_prev;
+        } else {
+            sched->ready_tail[priority] = task->ready_prev;
+        }
+        if (NULL == sched->ready_head[priority]) {
+            sched->ready &= ~((uint32_t) 1 << priority);
+        }
+
+        task->ready_next = NULL;
+        task->ready_prev = NULL;
+        task->is_ready = false;
+    }
+}
+
+
+static void
+on_release(void * hint, struct stimer * ts)
+{
+    (void) ts;
+    make_ready((struct stimer_task *) hint);
+}
+
+
+// ----------------------------------------------------------- Public functions
+
+// ---------------------- Scheduler
+
+struct stimer_sched *
+stimer_alloc_sched(struct stimer_ctx * ctx)
+{
+    struct stimer_sched * sched = NULL;
+    if (NULL != ctx) {
+        sched = (struct stimer_sched *) malloc(sizeof(struct stimer_sched));
+    }
+
+    if (NULL != sched) {
+        sched->ctx = ctx;
+        sched->tasks = NULL;
+
+        unsigned int i;
+        for (i = 0; i < STIMER_SCHED_PRIORITIES; ++i) {
+            sched->ready_head[i] = NULL;
+            sched->ready_tail[i] = NULL;
+        }
+        sched->ready = 0;
+    }
+
+    return sched;
+}
+
+
+void
+stimer_free_sched(struct stimer_sched * sched)
+{
+    if (NULL != sched) {
+        while (NULL != sched->tasks) {
+            stimer_free_task(sched->tasks);
+        }
+        free(sched);
+    }
+}
+
+
+uint32_t
+stimer_sched_run(struct stimer_sched * sched)
+{
+    uint32_t run_count = 0;
+    if (NULL != sched) {
+        stimer_execute_context(sched->ctx);
+
+        while (0 != sched->ready) {
+            unsigned int priority = find_first_set_64(sched->ready);
+            struct stimer_task * task = sched->ready_head[priority];
+            make_unready(task);
+
+            if (task->is_periodic) {
+                stimer_advance(task->timer);
+            } else {
+                stimer_stop(task->timer);
+            }
+
+            // The task may free itself, so it is not touched after this
+            task->task_fn(task->hint);
+            ++run_count;
+        }
+    }
+    return run_count;
+}
+
+
+// ---------------------- Task
+
+struct stimer_task *
+stimer_alloc_task(struct stimer_sched * sched,
+                  uint8_t priority,
+                  stimer_task_fn task_fn,
+                  void * hint)
+{
+    struct stimer_task * task = NULL;
+    if ((NULL != sched) && (NULL != task_fn) && (priority < STIMER_SCHED_PRIORITIES)) {
+        task = (struct stimer_task *) malloc(sizeof(struct stimer_task));
+    }
+
+    if (NULL != task) {
+        task->timer = stimer_alloc(sched->ctx);
+        if (NULL == task->timer) {
+            free(task);
+            task = NULL;
+        }
+    }
+
+    if (NULL != task) {
+        task->sched = sched;
+        task->prev = NULL;
+        task->next = sched->tasks;
+        if (NULL != task->next) {
+            task->next->prev = task;
+        }
+        sched->tasks = task;
+
+        task->ready_next = NULL;
+        task->ready_prev = NULL;
+        task->is_ready = false;
+
+        task->is_periodic = false;
+        task->task_fn = task_fn;
+        task->hint = hint;
+        task->priority = priority;
+
+        // The scheduler needs the expire callback to make tasks ready
+        if (!stimer_set_expire_callback(task->timer, task, on_release)) {
+            stimer_free_task(task);
+            task = NULL;
+        }
+    }
+
+    return task;
+}
+
+
+void
+stimer_free_task(struct stimer_task * task)
+{
+    if (NULL != task) {
+        struct stimer_sched * sched = task->sched;
+
+        make_unready(task);
+        stimer_free(task->timer);
+
+        if (NULL != task->prev) {
+            task->prev->next = task->next;
+        } else {
+            sched->tasks = task->next;
+        }
+        if (NULL != task->next) {
+            task->next->prev = task->prev;
+        }
+
+        free(task);
+    }
+}
+
+
+void
+stimer_task_every(struct stimer_task * task, struct stimer_duration * t)
+{
+    if (NULL != task) {
+        make_unready(task);
+        task->is_periodic = true;
+        stimer_expire_from_now(task->timer, t);
+    }
+}
+
+
+void
+stimer_task_every_ms(struct stimer_task * task, uint32_t ms)
+{
+    if (NULL != task) {
+        make_unready(task);
+        task->is_periodic = true;
+        stimer_expire_from_now_ms(task->timer, ms);
+    }
+}
+
+
+void
+stimer_task_after(struct stimer_task * task, struct stimer_duration * t)
+{
+    if (NULL != task) {
+        make_unready(task);
+        task->is_periodic = false;
+        stimer_expire_from_now(task->timer, t);
+    }
+}
+
+
+void
+stimer_task_after_ms(struct stimer_task * task, uint32_t ms)
+{
+    if (NULL != task) {
+        make_unready(task);
+        task->is_periodic = false;
+        stimer_expire_from_now_ms(task->timer, ms);
+    }
+}
+
+
+void
+stimer_task_cancel(struct stimer_task * task)
+{
+    if (NULL != task) {
+        make_unready(task);
+        stimer_stop(task->timer);
+    }
+}
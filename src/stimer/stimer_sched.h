@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_SCHED_H_
+#define STIMER_SCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stimer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+// ------------------------------------------------------------ Task structures
+
+// Number of task priorities. 0 is the highest
+#define STIMER_SCHED_PRIORITIES         32
+
+
+// ---------------------- Scheduler
+struct stimer_sched;
+
+// ---------------------- Task
+struct stimer_task;
+
+
+/**
+ * @brief Function pointer prototype for a task
+ *
+ * @param hint Hint parameter given to stimer_alloc_task
+ */
+typedef void (*stimer_task_fn)(void * hint);
+
+
+// ------------------------------------------------------------------ Scheduler
+
+/**
+ * @brief Allocates a run to completion task scheduler on the heap
+ * @details Every task has a timer in the context, and is made ready by the
+ *          timer expire callback when stimer_execute_context sees the timer
+ *          expire. Deciding which tasks are due therefore costs what the
+ *          context backend costs to find expired timers, instead of a check
+ *          of every task.
+ *
+ * @param ctx Timer context the task timers are allocated from
+ * @return Scheduler, or NULL on an error
+ */
+struct stimer_sched *
+stimer_alloc_sched(struct stimer_ctx * ctx);
+
+
+/**
+ * @brief Deallocates a scheduler and all of its tasks
+ *
+ * @param sched Scheduler to free
+ */
+void
+stimer_free_sched(struct stimer_sched * sched);
+
+
+/**
+ * @brief Executes the timer context and runs every task that is due
+ * @details Due tasks run one at a time, to completion, highest priority
+ *          first and in the order they became due within a priority. A
+ *          periodic task is advanced by one period before it runs, so a
+ *          task that fell behind by several periods runs on each of the next
+ *          calls until it catches up. A task may arm, cancel or free any
+ *          task, but must not free the scheduler or call this function.
+ *
+ * @param sched Scheduler to run
+ * @return Number of tasks run
+ */
+uint32_t
+stimer_sched_run(struct stimer_sched * sched);
+
+
+// ----------------------------------------------------------------------- Task
+
+/**
+ * @brief Allocates a task on the heap
+ * @details The task is idle until it is given a period or a deadline. Tasks
+ *          are made ready by the expire callback of their timer, so this
+ *          fails unless the library is built with
+ *          STIMER_CONFIG_EXPIRE_CALLBACK defined to 1.
+ *
+ * @param sched Scheduler the task belongs to
+ * @param priority Task priority, 0 is the highest and
+ *          STIMER_SCHED_PRIORITIES - 1 the lowest
+ * @param task_fn Task function
+ * @param hint Optional hint parameter for the task_fn function
+ * @return Task, or NULL on an error
+ */
+struct stimer_task *
+stimer_alloc_task(struct stimer_sched * sched,
+                  uint8_t priority,
+                  stimer_task_fn task_fn,
+                  void * hint);
+
+
+/**
+ * @brief Deallocates a task
+ *
+ * @param task Task to free
+ */
+void
+stimer_free_task(struct stimer_task * task);
+
+
+/**
+ * @brief Runs the task periodically, first one period from now
+ *
+ * @param task Task handle
+ * @param t Period
+ */
+void
+stimer_task_every(struct stimer_task * task, struct stimer_duration * t);
+
+
+/**
+ * @brief Runs the task periodically, first one period from now
+ *
+ * @param task Task handle
+ * @param ms Period in milliseconds
+ */
+void
+stimer_task_every_ms(struct stimer_task * task, uint32_t ms);
+
+
+/**
+ * @brief Runs the task once, at a deadline from now
+ *
+ * @param task Task handle
+ * @param t Time until the deadline
+ */
+void
+stimer_task_after(struct stimer_task * task, struct stimer_duration * t);
+
+
+/**
+ * @brief Runs the task once, at a deadline from now
+ *
+ * @param task Task handle
+ * @param ms Milliseconds until the deadline
+ */
+void
+stimer_task_after_ms(struct stimer_task * task, uint32_t ms);
+
+
+/**
+ * @brief Makes the task idle, including if it is already due
+ *
+ * @param task Task handle
+ */
+void
+stimer_task_cancel(struct stimer_task * task);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* STIMER_SCHED_H_ */
@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "stimer_private.h"
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_SORTED_LIST
+
+// ---------------------------------------------------------- Private functions
+
+static void
+unlink_timer(struct stimer_index * list, struct stimer * ts)
+{
+    if (NULL != ts->next) {
+        ts->next->prev = ts->prev;
+    }
+
+    if (NULL != ts->prev) {
+        ts->prev->next = ts->next;
+    } else {
+        list->head = ts->next;
+    }
+    ts->next = NULL;
+    ts->prev = NULL;
+}
+
+
+static void
+insert_timer(struct stimer_index * list, struct stimer * ts)
+{
+    // Walk past every timer due at or before the deadline. The list keys on
+    // the deadline each timer already holds, so it adds nothing per timer
+    uint64_t deadline = get_expire_deadline(ts);
+    struct stimer * prev = NULL;
+    struct stimer * next = list->head;
+    while ((NULL != next) && (get_expire_deadline(next) <= deadline)) {
+        prev = next;
+        next = next->next;
+    }
+
+    ts->prev = prev;
+    ts->next = next;
+    if (NULL != next) {
+        next->prev = ts;
+    }
+    if (NULL != prev) {
+        prev->next = ts;
+    } else {
+        list->head = ts;
+    }
+}
+
+
+// ----------------------------------------------------------- Index functions
+
+bool
+stimer_index_init(struct stimer_ctx * ctx)
+{
+    ctx->index.head = NULL;
+    return true;
+}
+
+
+void
+stimer_index_deinit(struct stimer_ctx * ctx)
+{
+    // Nothing allocated
+    (void) ctx;
+}
+
+
+void
+stimer_index_insert(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    insert_timer(&ctx->index, ts);
+}
+
+
+void
+stimer_index_remove(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    unlink_timer(&ctx->index, ts);
+}
+
+
+void
+stimer_index_update(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    unlink_timer(&ctx->index, ts);
+    insert_timer(&ctx->index, ts);
+}
+
+
+struct stimer *
+stimer_index_pop_expired(struct stimer_ctx * ctx, uint64_t now)
+{
+    // Only the head is inspected, so a pass with nothing expired is O(1)
+    struct stimer_index * list = &ctx->index;
+    struct stimer * ts = list->head;
+
+    if ((NULL != ts) && (get_expire_deadline(ts) <= now)) {
+        unlink_timer(list, ts);
+    } else {
+        ts = NULL;
+    }
+    return ts;
+}
+
+
+uint64_t
+stimer_index_next(struct stimer_ctx * ctx)
+{
+    struct stimer * ts = ctx->index.head;
+    return (NULL != ts) ? get_expire_deadline(ts) : UINT64_MAX;
+}
+
+
+struct stimer *
+stimer_index_first(struct stimer_ctx * ctx)
+{
+    return ctx->index.head;
+}
+
+#endif /* STIMER_CONFIG_BACKEND == STIMER_BACKEND_SORTED_LIST */
@@ -0,0 +1,274 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "stimer_private.h"
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_WHEEL
+
+// ---------------------------------------------------------- Private functions
+
+static void
+push_timer(struct stimer ** list, struct stimer * ts)
+{
+    ts->prev = NULL;
+    ts->next = *list;
+    if (NULL != ts->next) {
+        ts->next->prev = ts;
+    }
+    *list = ts;
+    ts->wheel_list = list;
+}
+
+
+static void
+place_in_wheel(struct stimer_index * wheel, struct stimer * ts)
+{
+    uint64_t deadline = get_expire_deadline(ts);
+
+    if (deadline <= wheel->now) {
+        push_timer(&wheel->expired, ts);
+        return;
+    }
+
+    // The highest bit that differs from the wheel time picks the level. Every
+    // timer on a level shares the bits above it with the wheel time
+    unsigned int level = find_last_set_64(deadline ^ wheel->now)
+                       / STIMER_WHEEL_BITS;
+
+    if (level >= STIMER_CONFIG_WHEEL_LEVELS) {
+        push_timer(&wheel->overflow, ts);
+        if (deadline < wheel->overflow_next) {
+            wheel->overflow_next = deadline;
+        }
+    } else {
+        unsigned int slot = (unsigned int)
+            (deadline >> (level * STIMER_WHEEL_BITS)) & (STIMER_WHEEL_SLOTS - 1);
+
+        push_timer(&wheel->slots[(level * STIMER_WHEEL_SLOTS) + slot], ts);
+        wheel->occupied[level] |= (uint64_t) 1 << slot;
+    }
+}
+
+
+static void
+unlink_from_wheel(struct stimer_index * wheel, struct stimer * ts)
+{
+    struct stimer ** list = ts->wheel_list;
+
+    if (NULL != ts->prev) {
+        ts->prev->next = ts->next;
+    } else {
+        *list = ts->next;
+    }
+    if (NULL != ts->next) {
+        ts->next->prev = ts->prev;
+    }
+    ts->next = NULL;
+    ts->prev = NULL;
+    ts->wheel_list = NULL;
+
+    // A stale overflow_next is fine, it is only a lower bound
+    if ((NULL == *list) && (list != &wheel->overflow) && (list != &wheel->expired)) {
+        size_t index = (size_t) (list - wheel->slots);
+        wheel->occupied[index / STIMER_WHEEL_SLOTS] &=
+            ~((uint64_t) 1 << (index % STIMER_WHEEL_SLOTS));
+    }
+}
+
+
+static bool
+find_next_slot(struct stimer_index * wheel, unsigned int * level, uint64_t * time)
+{
+    // Slots on a lower level always come before slots on a higher one, so
+    // the lowest set bit of the first non-empty level is the next slot
+    unsigned int l;
+    for (l = 0; l < STIMER_CONFIG_WHEEL_LEVELS; ++l) {
+        if (0 != wheel->occupied[l]) {
+            unsigned int shift = l * STIMER_WHEEL_BITS;
+            uint64_t slot = find_first_set_64(wheel->occupied[l]);
+            uint64_t upper_mask = ~(((uint64_t) 1 << (shift + STIMER_WHEEL_BITS)) - 1);
+
+            *level = l;
+            *time = (wheel->now & upper_mask) | (slot << shift);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static void
+reinsert_list(struct stimer_index * wheel, struct stimer * ts)
+{
+    while (NULL != ts) {
+        struct stimer * next = ts->next;
+        place_in_wheel(wheel, ts);
+        ts = next;
+    }
+}
+
+
+static void
+advance_wheel(struct stimer_index * wheel, uint64_t target)
+{
+    // Step to each non-empty slot up to the target, moving its timers down a
+    // level or onto the expired list
+    for (;;) {
+        unsigned int level = 0;
+        uint64_t slot_time = UINT64_MAX;
+        bool has_slot = find_next_slot(wheel, &level, &slot_time);
+        uint64_t overflow_time = (NULL != wheel->overflow) ?
+            wheel->overflow_next : UINT64_MAX;
+
+        if ((overflow_time <= slot_time) && (overflow_time <= target)) {
+            struct stimer * list = wheel->overflow;
+            wheel->overflow = NULL;
+            wheel->overflow_next = UINT64_MAX;
+            wheel->now = overflow_time;
+            reinsert_list(wheel, list);
+        } else if (has_slot && (slot_time <= target)) {
+            unsigned int slot = (unsigned int)
+                (slot_time >> (level * STIMER_WHEEL_BITS)) & (STIMER_WHEEL_SLOTS - 1);
+            struct stimer ** slot_list = &wheel->slots[(level * STIMER_WHEEL_SLOTS) + slot];
+            struct stimer * list = *slot_list;
+
+            *slot_list = NULL;
+            wheel->occupied[level] &= ~((uint64_t) 1 << slot);
+            wheel->now = slot_time;
+            reinsert_list(wheel, list);
+        } else {
+            break;
+        }
+    }
+
+    if (target > wheel->now) {
+        wheel->now = target;
+    }
+}
+
+
+// ----------------------------------------------------------- Index functions
+
+bool
+stimer_index_init(struct stimer_ctx * ctx)
+{
+    struct stimer_index * wheel = &ctx->index;
+    unsigned int i;
+
+    wheel->now = ctx->now_ticks;
+    for (i = 0; i < (STIMER_CONFIG_WHEEL_LEVELS * STIMER_WHEEL_SLOTS); ++i) {
+        wheel->slots[i] = NULL;
+    }
+    for (i = 0; i < STIMER_CONFIG_WHEEL_LEVELS; ++i) {
+        wheel->occupied[i] = 0;
+    }
+    wheel->overflow = NULL;
+    wheel->overflow_next = UINT64_MAX;
+    wheel->expired = NULL;
+    return true;
+}
+
+
+void
+stimer_index_deinit(struct stimer_ctx * ctx)
+{
+    // Nothing allocated
+    (void) ctx;
+}
+
+
+void
+stimer_index_insert(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    place_in_wheel(&ctx->index, ts);
+}
+
+
+void
+stimer_index_remove(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    unlink_from_wheel(&ctx->index, ts);
+}
+
+
+void
+stimer_index_update(struct stimer_ctx * ctx, struct stimer * ts)
+{
+    unlink_from_wheel(&ctx->index, ts);
+    place_in_wheel(&ctx->index, ts);
+}
+
+
+struct stimer *
+stimer_index_pop_expired(struct stimer_ctx * ctx, uint64_t now)
+{
+    struct stimer_index * wheel = &ctx->index;
+    if (NULL == wheel->expired) {
+        advance_wheel(wheel, now);
+    }
+
+    struct stimer * ts = wheel->expired;
+    if (NULL != ts) {
+        unlink_from_wheel(wheel, ts);
+    }
+    return ts;
+}
+
+
+uint64_t
+stimer_index_next(struct stimer_ctx * ctx)
+{
+    struct stimer_index * wheel = &ctx->index;
+    uint64_t next = UINT64_MAX;
+
+    if (NULL != wheel->expired) {
+        next = wheel->now;
+    } else {
+        unsigned int level;
+        (void) find_next_slot(wheel, &level, &next);
+        if ((NULL != wheel->overflow) && (wheel->overflow_next < next)) {
+            next = wheel->overflow_next;
+        }
+    }
+    return next;
+}
+
+
+struct stimer *
+stimer_index_first(struct stimer_ctx * ctx)
+{
+    struct stimer_index * wheel = &ctx->index;
+    struct stimer * ts = (NULL != wheel->expired) ? wheel->expired : wheel->overflow;
+
+    unsigned int level;
+    for (level = 0; (NULL == ts) && (level < STIMER_CONFIG_WHEEL_LEVELS); ++level) {
+        if (0 != wheel->occupied[level]) {
+            unsigned int slot = find_first_set_64(wheel->occupied[level]);
+            ts = wheel->slots[(level * STIMER_WHEEL_SLOTS) + slot];
+        }
+    }
+    return ts;
+}
+
+#endif /* STIMER_CONFIG_BACKEND == STIMER_BACKEND_WHEEL */
@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "stimer_window.h"
+
+// -------------------------------------------------------------- Private types
+
+struct stimer_window {
+    // Timer context
+    struct stimer_ctx *                 ctx;
+
+
+    // Ring of bucket counts, the current bucket, and the sum of the ring
+    uint32_t *                          counts;
+    uint16_t                            bucket_count;
+    uint16_t                            current;
+    uint32_t                            total;
+
+
+    // Bucket width, and the context time the current bucket ends at
+    uint64_t                            width_ticks;
+    uint64_t                            end_ticks;
+    uint64_t                            window_ns;
+};
+
+
+// ---------------------------------------------------------- Private functions
+
+static void
+clear_buckets(struct stimer_window * window, uint64_t now)
+{
+    uint16_t i;
+    for (i = 0; i < window->bucket_count; ++i) {
+        window->counts[i] = 0;
+    }
+    window->current = 0;
+    window->total = 0;
+    window->end_ticks = now + window->width_ticks;
+}
+
+
+static void
+slide_window(struct stimer_window * window)
+{
+    uint64_t now = stimer_get_context_ticks(window->ctx);
+    if (now < window->end_ticks) {
+        return;
+    }
+
+    // Past the whole ring, everything is dropped and the buckets are
+    // realigned to now. Otherwise step over each bucket that was passed
+    uint64_t passed = now - window->end_ticks;
+    if (passed >= ((uint64_t) window->bucket_count * window->width_ticks)) {
+        clear_buckets(window, now);
+    } else {
+        while (now >= window->end_ticks) {
+            window->current = (uint16_t) (window->current + 1u);
+            if (window->current >= window->bucket_count) {
+                window->current = 0;
+            }
+            window->total -= window->counts[window->current];
+            window->counts[window->current] = 0;
+            window->end_ticks += window->width_ticks;
+        }
+    }
+}
+
+
+// ----------------------------------------------------------- Public functions
+
+struct stimer_window *
+stimer_alloc_window(struct stimer_ctx * ctx,
+                    uint16_t buckets,
+                    struct stimer_duration * width)
+{
+    struct stimer_window * window = NULL;
+    uint64_t width_ticks = 0;
+    if ((NULL != ctx) && (0 != buckets) && (NULL != width)) {
+        width_ticks = stimer_duration_to_ticks(ctx, width);
+    }
+    if (0 != width_ticks) {
+        window = (struct stimer_window *) malloc(sizeof(struct stimer_window));
+    }
+
+    if (NULL != window) {
+        window->counts = (uint32_t *) malloc((size_t) buckets * sizeof(uint32_t));
+        if (NULL == window->counts) {
+            free(window);
+            window = NULL;
+        }
+    }
+
+    if (NULL != window) {
+        struct stimer_duration span;
+        stimer_ticks_to_duration(ctx, (uint64_t) buckets * width_ticks, &span);
+
+        window->ctx = ctx;
+        window->bucket_count = buckets;
+        window->width_ticks = width_ticks;
+        window->window_ns = ((uint64_t) span.seconds * 1000000000u) + span.nanoseconds;
+        clear_buckets(window, stimer_get_context_ticks(ctx));
+    }
+
+    return window;
+}
+
+
+void
+stimer_free_window(struct stimer_window * window)
+{
+    if (NULL != window) {
+        free(window->counts);
+        free(window);
+    }
+}
+
+
+void
+stimer_window_add(struct stimer_window * window, uint32_t events)
+{
+    if (NULL != window) {
+        slide_window(window);
+        window->counts[window->current] += events;
+        window->total += events;
+    }
+}
+
+
+uint32_t
+stimer_window_get_count(struct stimer_window * window)
+{
+    uint32_t count = 0;
+    if (NULL != window) {
+        slide_window(window);
+        count = window->total;
+    }
+    return count;
+}
+
+
+uint32_t
+stimer_window_get_rate_per_s(struct stimer_window * window)
+{
+    uint64_t rate = 0;
+    if (NULL != window) {
+        uint64_t count = stimer_window_get_count(window);
+        rate = (count * 1000000000u) / window->window_ns;
+    }
+    return (rate > UINT32_MAX) ? UINT32_MAX : (uint32_t) rate;
+}
+
+
+void
+stimer_window_reset(struct stimer_window * window)
+{
+    if (NULL != window) {
+        clear_buckets(window, stimer_get_context_ticks(window->ctx));
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STIMER_WINDOW_H_
+#define STIMER_WINDOW_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stimer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+// ---------------------------------------------------------- Window structures
+
+// ---------------------- Window
+struct stimer_window;
+
+
+// --------------------------------------------------------------------- Window
+
+/**
+ * @brief Allocates a sliding window event counter on the heap
+ * @details The window is a ring of buckets, each counting the events of one
+ *          bucket width of time. The ring is moved forward lazily, from the
+ *          context clock, when events are added or the count is read. Adding
+ *          and reading are constant time, plus clearing the buckets that
+ *          were passed since the last call, and no timers are used.
+ *
+ * @param ctx Timer context, used for the clock
+ * @param buckets Number of buckets in the window, must not be 0
+ * @param width Time covered by each bucket
+ * @return Window, or NULL on an error
+ */
+struct stimer_window *
+stimer_alloc_window(struct stimer_ctx * ctx,
+                    uint16_t buckets,
+                    struct stimer_duration * width);
+
+
+/**
+ * @brief Deallocates a sliding window event counter
+ *
+ * @param window Window to free
+ */
+void
+stimer_free_window(struct stimer_window * window);
+
+
+/**
+ * @brief Counts events in the window
+ *
+ * @param window Window
+ * @param events Number of events
+ */
+void
+stimer_window_add(struct stimer_window * window, uint32_t events);
+
+
+/**
+ * @brief Gets the number of events in the window
+ * @details The window is the current bucket, which is partly filled, and the
+ *          buckets - 1 full buckets before it
+ *
+ * @param window Window
+ * @return Number of events
+ */
+uint32_t
+stimer_window_get_count(struct stimer_window * window);
+
+
+/**
+ * @brief Gets the event rate over the window
+ * @details Same as the count divided by buckets times the bucket width
+ *
+ * @param window Window
+ * @return Events per second, rounded down
+ */
+uint32_t
+stimer_window_get_rate_per_s(struct stimer_window * window);
+
+
+/**
+ * @brief Clears every bucket
+ *
+ * @param window Window
+ */
+void
+stimer_window_reset(struct stimer_window * window);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* STIMER_WINDOW_H_ */
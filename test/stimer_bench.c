@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stimer/stimer.h"
+#include "stimer/stimer_private.h"
+
+
+// Timer benchmark. Arms, rearms and runs a large number of timers with widely
+// varying deadlines, and prints the cost per operation for the configured
+// backend. Build it once per STIMER_CONFIG_BACKEND to compare them.
+//
+// Usage: stimer_bench [timers] [steps]
+
+
+// Arming the sorted list walks it, which makes every arm O(n). Its default is
+// kept small enough to finish in a few seconds
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_SORTED_LIST
+#define BENCH_DEFAULT_TIMERS            5000u
+#else
+#define BENCH_DEFAULT_TIMERS            100000u
+#endif
+
+
+static const char * const backend_names[] = {
+    "list",
+    "wheel",
+    "calendar",
+    "radix",
+    "pairing",
+    "sorted",
+};
+
+
+static uint32_t current_time = 0;
+static uint32_t seed = 1;
+
+
+static uint32_t
+bench_get_time(void * hint)
+{
+    (void) hint;
+    return current_time;
+}
+
+
+static uint32_t
+random_deadline_us(void)
+{
+    // Mostly near term, with a tail out to about 100 seconds
+    seed = (seed * 1103515245u) + 12345u;
+    uint32_t r = seed >> 8;
+    uint32_t range = ((r & 0xFu) == 0) ? 100000000u : 100000u;
+    return 1u + ((r >> 4) % range);
+}
+
+
+static uint64_t
+get_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000u) + (uint64_t) ts.tv_nsec;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    uint32_t timer_count = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : BENCH_DEFAULT_TIMERS;
+    uint32_t step_count = (argc > 2) ? (uint32_t) strtoul(argv[2], NULL, 0) : 1000u;
+
+    // 1us per count
+    struct stimer_ctx * ctx = stimer_alloc_context(NULL, bench_get_time, UINT32_MAX, 1000);
+    struct stimer ** timers = (struct stimer **) malloc(timer_count * sizeof(struct stimer *));
+    if ((NULL == ctx) || (NULL == timers)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    uint32_t i;
+    for (i = 0; i < timer_count; ++i) {
+        timers[i] = stimer_alloc(ctx);
+        if (NULL == timers[i]) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    // Arm every timer
+    uint64_t start = get_ns();
+    for (i = 0; i < timer_count; ++i) {
+        stimer_expire_from_now_us(timers[i], random_deadline_us());
+    }
+    uint64_t arm_ns = get_ns() - start;
+
+    // Rearm every timer, moving its deadline
+    start = get_ns();
+    for (i = 0; i < timer_count; ++i) {
+        stimer_expire_from_now_us(timers[i], random_deadline_us());
+    }
+    uint64_t rearm_ns = get_ns() - start;
+
+    // Restart every timer a little later, which only moves deadlines later
+    current_time += 1000u;
+    start = get_ns();
+    for (i = 0; i < timer_count; ++i) {
+        stimer_restart_from_now(timers[i]);
+    }
+    uint64_t restart_ns = get_ns() - start;
+
+    // Run 1ms steps, rearming the timers that expire. Only the execute calls
+    // are timed
+    uint64_t execute_ns = 0;
+    uint64_t expired = 0;
+    uint32_t step;
+    for (step = 0; step < step_count; ++step) {
+        current_time += 1000u;
+
+        start = get_ns();
+        stimer_execute_context(ctx);
+        execute_ns += get_ns() - start;
+
+        for (i = 0; i < timer_count; ++i) {
+            if (stimer_is_expired(timers[i])) {
+                stimer_expire_from_now_us(timers[i], random_deadline_us());
+                ++expired;
+            }
+        }
+    }
+
+    printf("backend %s, %lu timers, %lu steps, %lu expired\n",
+           backend_names[STIMER_CONFIG_BACKEND],
+           (unsigned long) timer_count,
+           (unsigned long) step_count,
+           (unsigned long) expired);
+    printf("  arm      %8.1f ns/timer\n", (double) arm_ns / timer_count);
+    printf("  rearm    %8.1f ns/timer\n", (double) rearm_ns / timer_count);
+    printf("  restart  %8.1f ns/timer\n", (double) restart_ns / timer_count);
+    printf("  execute  %8.1f us/step\n", (double) execute_ns / 1000.0 / step_count);
+
+    for (i = 0; i < timer_count; ++i) {
+        stimer_free(timers[i]);
+    }
+    free(timers);
+    stimer_free_context(ctx);
+    return 0;
+}
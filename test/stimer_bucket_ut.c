@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "describe/describe.h"
+
+#include "stimer/stimer_bucket.h"
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("Token bucket") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_rate rate;
+        struct stimer_bucket bucket;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            // 3 tokens every 10ms, a third of a tick apart
+            struct stimer_duration period = { 0, 10000000 };
+            assert_equal(true, stimer_rate_init(&rate, ctx, 3, &period, 3));
+            assert_equal(false, stimer_rate_init(&rate, ctx, 0, &period, 3));
+
+            stimer_bucket_init(&bucket);
+        }
+
+        it("starts full") {
+            assert_equal(0, stimer_bucket_get_wait_ticks(&rate, &bucket, 3));
+            assert_equal(true, stimer_bucket_take(&rate, &bucket, 3));
+            assert_equal(false, stimer_bucket_take(&rate, &bucket, 1));
+        }
+
+        it("refills at the rate") {
+            assert_equal(4, stimer_bucket_get_wait_ticks(&rate, &bucket, 1));
+
+            current_time = 3;
+            assert_equal(false, stimer_bucket_take(&rate, &bucket, 1));
+
+            current_time = 4;
+            assert_equal(true, stimer_bucket_take(&rate, &bucket, 1));
+            assert_equal(false, stimer_bucket_take(&rate, &bucket, 1));
+
+            // 100 ticks at 3 tokens per 10 ticks
+            uint32_t taken = 0;
+            uint32_t i;
+            for (i = 0; i < 100; ++i) {
+                current_time = (current_time + 1) & 0xFF;
+                while (stimer_bucket_take(&rate, &bucket, 1)) {
+                    ++taken;
+                }
+            }
+            assert_equal(30, taken);
+        }
+
+        it("does not fill past the burst") {
+            uint32_t i;
+            for (i = 0; i < 1000; ++i) {
+                current_time = (current_time + 1) & 0xFF;
+                (void) stimer_get_context_ticks(ctx);
+            }
+            assert_equal(UINT64_MAX, stimer_bucket_get_wait_ticks(&rate, &bucket, 4));
+            assert_equal(false, stimer_bucket_take(&rate, &bucket, 4));
+            assert_equal(true, stimer_bucket_take(&rate, &bucket, 3));
+            assert_equal(false, stimer_bucket_take(&rate, &bucket, 1));
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_context(ctx);
+        }
+    }
+
+    describe("Leaky bucket") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_rate rate;
+        struct stimer_bucket bucket;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            assert_equal(true, stimer_rate_init_per_s(&rate, ctx, 100, 3));
+            stimer_bucket_init(&bucket);
+        }
+
+        it("spaces queued units at the rate") {
+            current_time = 5;
+            assert_equal(0, stimer_bucket_queue(&rate, &bucket, 1));
+            assert_equal(10, stimer_bucket_queue(&rate, &bucket, 1));
+            assert_equal(20, stimer_bucket_queue(&rate, &bucket, 1));
+        }
+
+        it("rejects units when the queue is full") {
+            assert_equal(UINT64_MAX, stimer_bucket_queue(&rate, &bucket, 1));
+
+            current_time = 15;
+            assert_equal(20, stimer_bucket_queue(&rate, &bucket, 1));
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+
+#include "describe/describe.h"
+
+#include "stimer/stimer_coro.hpp"
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+// Appends the name to the run log
+static void
+log_name(char * log, char name)
+{
+    char * end = log;
+    while ('\0' != *end) {
+        ++end;
+    }
+    end[0] = name;
+    end[1] = '\0';
+}
+
+
+static soft_timer::Task
+sleeper(soft_timer::Executor & executor, char * log, char name, int ms, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        co_await executor.sleep_for(std::chrono::milliseconds(ms));
+        log_name(log, name);
+    }
+}
+
+
+struct frame_guard {
+    int * destroyed;
+    ~frame_guard() { *destroyed += 1; }
+};
+
+
+static soft_timer::Task
+guarded_sleeper(soft_timer::Executor & executor, int * destroyed)
+{
+    frame_guard guard = { destroyed };
+    co_await executor.sleep_for(std::chrono::seconds(10));
+}
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("C++ coroutine executor") {
+        uint32_t current_time = 0;
+        soft_timer::Context ctx(&current_time, mock_get_time, 0xFF, std::chrono::milliseconds(1));
+        char log[32] = "";
+
+        it("allocates the executor") {
+            soft_timer::Executor executor(ctx);
+            assert_equal(true, static_cast<bool>(executor));
+            assert_equal(true, executor.is_idle());
+        }
+
+        it("wakes sleepers in deadline order") {
+            soft_timer::Executor executor(ctx);
+            log[0] = '\0';
+
+            sleeper(executor, log, 'c', 30, 1);
+            sleeper(executor, log, 'a', 10, 1);
+            sleeper(executor, log, 'b', 20, 1);
+            assert_equal(false, executor.is_idle());
+            assert_equal(10, ctx.ticks_until_next());
+
+            current_time += 9;
+            executor.run_once();
+            assert_equal('\0', log[0]);
+
+            current_time += 1;
+            executor.run_once();
+            assert_equal('a', log[0]);
+            assert_equal(10, ctx.ticks_until_next());
+
+            current_time += 20;
+            executor.run_once();
+            assert_equal('b', log[1]);
+            assert_equal('c', log[2]);
+            assert_equal('\0', log[3]);
+            assert_equal(true, executor.is_idle());
+        }
+
+        it("wakes equal sleeps in the order they started") {
+            soft_timer::Executor executor(ctx);
+            log[0] = '\0';
+
+            sleeper(executor, log, 'a', 5, 1);
+            sleeper(executor, log, 'b', 5, 1);
+            sleeper(executor, log, 'c', 5, 1);
+
+            current_time += 5;
+            executor.run_once();
+            assert_equal('a', log[0]);
+            assert_equal('b', log[1]);
+            assert_equal('c', log[2]);
+        }
+
+        it("requeues coroutines that sleep again") {
+            soft_timer::Executor executor(ctx);
+            log[0] = '\0';
+
+            sleeper(executor, log, 'a', 2, 3);
+            sleeper(executor, log, 'b', 3, 2);
+
+            int i;
+            for (i = 0; i < 6; ++i) {
+                current_time += 1;
+                executor.run_once();
+            }
+            assert_equal('a', log[0]);
+            assert_equal('b', log[1]);
+            assert_equal('a', log[2]);
+            assert_equal('b', log[3]);
+            assert_equal('a', log[4]);
+            assert_equal(true, executor.is_idle());
+        }
+
+        it("does not suspend for an empty sleep") {
+            soft_timer::Executor executor(ctx);
+            log[0] = '\0';
+
+            sleeper(executor, log, 'a', 0, 1);
+            assert_equal('a', log[0]);
+            assert_equal(true, executor.is_idle());
+        }
+
+        it("destroys sleeping coroutines with the executor") {
+            int destroyed = 0;
+            {
+                soft_timer::Executor executor(ctx);
+                guarded_sleeper(executor, &destroyed);
+                guarded_sleeper(executor, &destroyed);
+                assert_equal(0, destroyed);
+            }
+            assert_equal(2, destroyed);
+            assert_equal(0x3F, ctx.ticks_until_next());
+        }
+    }
+
+
+    return 0;
+}
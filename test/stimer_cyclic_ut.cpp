@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstring>
+
+#include "describe/describe.h"
+
+#include "stimer/stimer_cyclic.hpp"
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+// Run log, one letter per task call
+static char run_log[64];
+
+
+static void
+log_name(char name)
+{
+    char * end = run_log;
+    while ('\0' != *end) {
+        ++end;
+    }
+    end[0] = name;
+    end[1] = '\0';
+}
+
+
+static void task_a(void * hint) { (void) hint; log_name('a'); }
+static void task_b(void * hint) { (void) hint; log_name('b'); }
+static void task_c(void * hint) { (void) hint; log_name('c'); }
+
+
+typedef soft_timer::CyclicSchedule<10, 20, 50> Schedule3;
+typedef soft_timer::CyclicSchedule<4, 6> Schedule2;
+
+static_assert(10 == Schedule3::minor_frame, "minor frame is the gcd");
+static_assert(100 == Schedule3::hyperperiod, "hyperperiod is the lcm");
+static_assert(10 == Schedule3::frame_count, "one table entry per minor frame");
+
+static_assert(12 == soft_timer::detail::lcm(4, 6), "lcm of small periods");
+static_assert(0 == soft_timer::detail::lcm(UINT64_MAX / 2, 3), "lcm overflow is 0");
+static_assert(0 == soft_timer::detail::lcm(0, 3), "lcm keeps an overflow");
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("C++ cyclic schedule") {
+        it("works out the minor frame and hyperperiod") {
+            assert_equal(10, Schedule3::minor_frame);
+            assert_equal(100, Schedule3::hyperperiod);
+            assert_equal(2, Schedule2::minor_frame);
+            assert_equal(12, Schedule2::hyperperiod);
+            assert_equal(6, Schedule2::frame_count);
+        }
+
+        it("releases every task in frame 0") {
+            assert_equal(0x7u, Schedule3::frames[0]);
+            assert_equal(0x3u, Schedule2::frames[0]);
+        }
+
+        it("releases tasks on their periods") {
+            const uint32_t expected3[] = { 0x7, 0x1, 0x3, 0x1, 0x3, 0x5, 0x3, 0x1, 0x3, 0x1 };
+            const uint32_t expected2[] = { 0x3, 0x0, 0x1, 0x2, 0x1, 0x0 };
+            std::size_t i;
+            for (i = 0; i < Schedule3::frame_count; ++i) {
+                assert_equal(expected3[i], Schedule3::frames[i]);
+            }
+            for (i = 0; i < Schedule2::frame_count; ++i) {
+                assert_equal(expected2[i], Schedule2::frames[i]);
+            }
+        }
+    }
+
+
+    describe("C++ cyclic executive") {
+        uint32_t current_time = 0;
+        soft_timer::Context ctx(&current_time, mock_get_time, 0xFF, std::chrono::milliseconds(1));
+
+        it("waits one minor frame before frame 0") {
+            soft_timer::CyclicExecutive<Schedule2> executive(
+                ctx, std::chrono::milliseconds(1), { task_a, task_b }, NULL);
+            assert_equal(true, static_cast<bool>(executive));
+            run_log[0] = '\0';
+
+            current_time += 1;
+            assert_equal(0, executive.poll());
+            assert_equal(0, executive.frame());
+
+            current_time += 1;
+            assert_equal(1, executive.poll());
+            assert_equal(1, executive.frame());
+            assert_equal('a', run_log[0]);
+            assert_equal('b', run_log[1]);
+            assert_equal('\0', run_log[2]);
+        }
+
+        it("dispatches each task once per period") {
+            soft_timer::CyclicExecutive<Schedule3> executive(
+                ctx, std::chrono::milliseconds(1), { task_a, task_b, task_c }, NULL);
+            run_log[0] = '\0';
+
+            int a = 0;
+            int b = 0;
+            int c = 0;
+            int i;
+            for (i = 0; i < 100; ++i) {
+                current_time = (current_time + 1) & 0xFF;
+                executive.poll();
+            }
+            for (i = 0; '\0' != run_log[i]; ++i) {
+                a += ('a' == run_log[i]) ? 1 : 0;
+                b += ('b' == run_log[i]) ? 1 : 0;
+                c += ('c' == run_log[i]) ? 1 : 0;
+            }
+            assert_equal(10, a);
+            assert_equal(5, b);
+            assert_equal(2, c);
+            assert_equal(0, executive.frame());
+            assert_equal(0, executive.overruns());
+        }
+
+        it("runs missed frames back to back and counts them") {
+            soft_timer::CyclicExecutive<Schedule2> executive(
+                ctx, std::chrono::milliseconds(1), { task_a, task_b }, NULL);
+            run_log[0] = '\0';
+
+            current_time = (current_time + 7) & 0xFF;
+            assert_equal(3, executive.poll());
+            assert_equal(3, executive.frame());
+            assert_equal(2, executive.overruns());
+            assert_equal(0, strcmp("aba", run_log));
+
+            current_time = (current_time + 1) & 0xFF;
+            assert_equal(1, executive.poll());
+            assert_equal(4, executive.frame());
+            assert_equal(2, executive.overruns());
+            assert_equal(0, strcmp("abab", run_log));
+        }
+    }
+
+
+    return 0;
+}
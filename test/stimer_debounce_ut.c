@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "describe/describe.h"
+
+#include "stimer/stimer_debounce.h"
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("Debounce") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_debounce db;
+        uint64_t hold = 0;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            hold = stimer_ms_to_ticks(ctx, 5);
+            assert_equal(5, hold);
+            stimer_debounce_init(&db, false);
+        }
+
+        it("ignores bounces shorter than the hold time") {
+            current_time = 10;
+            assert_equal(false, stimer_debounce_update(ctx, &db, true, hold));
+            current_time = 12;
+            assert_equal(false, stimer_debounce_update(ctx, &db, false, hold));
+            current_time = 13;
+            assert_equal(false, stimer_debounce_update(ctx, &db, true, hold));
+            current_time = 17;
+            assert_equal(false, stimer_debounce_update(ctx, &db, true, hold));
+        }
+
+        it("follows an input that holds") {
+            current_time = 18;
+            assert_equal(true, stimer_debounce_update(ctx, &db, true, hold));
+
+            current_time = 20;
+            assert_equal(true, stimer_debounce_update(ctx, &db, false, hold));
+            current_time = 25;
+            assert_equal(false, stimer_debounce_update(ctx, &db, false, hold));
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_context(ctx);
+        }
+    }
+
+    describe("Throttle") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_throttle th;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            stimer_throttle_init(&th);
+        }
+
+        it("allows the first event straight away") {
+            assert_equal(true, stimer_throttle_allow(ctx, &th, 10));
+        }
+
+        it("allows one event per interval") {
+            uint32_t allowed = 0;
+            uint32_t i;
+            for (i = 0; i < 100; ++i) {
+                current_time += 1;
+                if (stimer_throttle_allow(ctx, &th, 10)) {
+                    ++allowed;
+                }
+            }
+            assert_equal(10, allowed);
+            assert_equal(90, stimer_throttle_take_suppressed(&th));
+            assert_equal(0, stimer_throttle_take_suppressed(&th));
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    return 0;
+}
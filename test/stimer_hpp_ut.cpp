@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <utility>
+
+#include "describe/describe.h"
+
+#include "stimer/stimer.hpp"
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("C++ timer") {
+        uint32_t current_time = 0;
+        soft_timer::Context ctx(&current_time, mock_get_time, 0xFF, std::chrono::milliseconds(1));
+
+        it("allocates the context") {
+            assert_equal(true, static_cast<bool>(ctx));
+            assert_not_null(ctx.get());
+        }
+
+        it("starts and stops a stopwatch") {
+            soft_timer::Timer t(ctx);
+            assert_equal(true, static_cast<bool>(t));
+
+            t.start();
+            current_time += 3;
+            assert_equal(3, t.elapsed_ticks());
+            assert_equal(true, std::chrono::milliseconds(3) == t.elapsed());
+
+            t.stop();
+            current_time += 2;
+            assert_equal(3, t.elapsed_ticks());
+        }
+
+        it("rounds chrono durations up to whole ticks") {
+            soft_timer::Timer t(ctx);
+
+            t.expire_from_now(std::chrono::milliseconds(5));
+            assert_equal(5, t.remaining_ticks());
+
+            t.expire_from_now(std::chrono::seconds(2));
+            assert_equal(2000, t.remaining_ticks());
+
+            t.expire_from_now(std::chrono::microseconds(2500));
+            assert_equal(3, t.remaining_ticks());
+
+            t.expire_from_now(std::chrono::duration<double, std::milli>(1.5));
+            assert_equal(2, t.remaining_ticks());
+
+            t.expire_from_now(std::chrono::milliseconds(-1));
+            assert_equal(true, t.is_expired());
+        }
+
+        it("expires and advances timers") {
+            soft_timer::Timer t(ctx);
+            t.expire_from_now(std::chrono::milliseconds(4));
+
+            current_time += 3;
+            ctx.execute();
+            assert_equal(false, t.is_expired());
+
+            current_time += 1;
+            ctx.execute();
+            assert_equal(true, t.is_expired());
+
+            t.advance();
+            assert_equal(false, t.is_expired());
+            assert_equal(4, t.remaining_ticks());
+        }
+
+        it("frees timers that go out of scope") {
+            {
+                soft_timer::Timer t(ctx);
+                t.expire_from_now(std::chrono::milliseconds(5));
+                assert_equal(5, ctx.ticks_until_next());
+            }
+            assert_equal(0x3F, ctx.ticks_until_next());
+        }
+
+        it("moves timer ownership") {
+            soft_timer::Timer a(ctx);
+            a.expire_from_now(std::chrono::milliseconds(5));
+
+            soft_timer::Timer b(std::move(a));
+            assert_equal(false, static_cast<bool>(a));
+            assert_equal(5, b.remaining_ticks());
+
+            soft_timer::Timer c;
+            assert_equal(false, static_cast<bool>(c));
+            c = std::move(b);
+            assert_equal(false, static_cast<bool>(b));
+            assert_equal(5, c.remaining_ticks());
+            assert_equal(5, ctx.ticks_until_next());
+
+            c = soft_timer::Timer();
+            assert_equal(0x3F, ctx.ticks_until_next());
+        }
+
+        it("keeps timers usable after their context is gone") {
+            soft_timer::Timer t;
+            {
+                soft_timer::Context other(&current_time, mock_get_time, 0xFF, 1000000);
+                t = soft_timer::Timer(other);
+                t.start();
+                current_time += 2;
+                assert_equal(2, t.elapsed_ticks());
+            }
+            assert_equal(true, static_cast<bool>(t));
+            assert_equal(0, t.elapsed_ticks());
+        }
+
+        it("moves context ownership") {
+            soft_timer::Context other(std::move(ctx));
+            assert_equal(false, static_cast<bool>(ctx));
+            assert_equal(true, static_cast<bool>(other));
+        }
+    }
+
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "describe/describe.h"
+
+#include "stimer/stimer_prof.h"
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+struct mock_dump {
+    struct stimer_prof_record records[8];
+    int count;
+};
+
+
+static void
+mock_visit(void * hint, const struct stimer_prof_record * record)
+{
+    struct mock_dump * dump = (struct mock_dump *) hint;
+    if (dump->count < 8) {
+        dump->records[dump->count] = *record;
+    }
+    dump->count += 1;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("Scope profiler") {
+        struct stimer_ctx * ctx = NULL;
+        struct stimer_prof * prof = NULL;
+        uint32_t current_time = 0;
+        struct mock_dump dump;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            prof = stimer_alloc_prof(ctx, 4, 3);
+            assert_not_null(prof);
+        }
+
+        it("records inclusive and exclusive time per scope") {
+            uint32_t i;
+            for (i = 0; i < 2; ++i) {
+                stimer_prof_enter(prof, "loop");
+                current_time += 1;
+
+                stimer_prof_enter(prof, "read");
+                current_time += 2;
+                stimer_prof_exit(prof);
+
+                stimer_prof_enter(prof, "write");
+                current_time += 3;
+                stimer_prof_enter(prof, "read");
+                current_time += 4;
+                stimer_prof_exit(prof);
+                stimer_prof_exit(prof);
+
+                stimer_prof_exit(prof);
+            }
+
+            dump.count = 0;
+            stimer_prof_visit(prof, &dump, mock_visit);
+            assert_equal(4, dump.count);
+
+            assert_equal(0, strcmp("loop", dump.records[0].name));
+            assert_equal(0, dump.records[0].depth);
+            assert_equal(2, dump.records[0].calls);
+            assert_equal(20, dump.records[0].inclusive_ticks);
+            assert_equal(2, dump.records[0].exclusive_ticks);
+
+            assert_equal(0, strcmp("read", dump.records[1].name));
+            assert_equal(1, dump.records[1].depth);
+            assert_equal(4, dump.records[1].inclusive_ticks);
+
+            assert_equal(0, strcmp("write", dump.records[2].name));
+            assert_equal(1, dump.records[2].depth);
+            assert_equal(14, dump.records[2].inclusive_ticks);
+            assert_equal(6, dump.records[2].exclusive_ticks);
+
+            assert_equal(0, strcmp("read", dump.records[3].name));
+            assert_equal(2, dump.records[3].depth);
+            assert_equal(8, dump.records[3].inclusive_ticks);
+            assert_equal(8, dump.records[3].exclusive_ticks);
+        }
+
+        it("drops scopes past its limits") {
+            stimer_prof_enter(prof, "loop");
+            stimer_prof_enter(prof, "write");
+            stimer_prof_enter(prof, "read");
+            stimer_prof_enter(prof, "too deep");
+            current_time += 5;
+            stimer_prof_exit(prof);
+            stimer_prof_exit(prof);
+            stimer_prof_exit(prof);
+            stimer_prof_exit(prof);
+
+            stimer_prof_enter(prof, "too many");
+            stimer_prof_exit(prof);
+
+            assert_equal(2, stimer_prof_get_dropped(prof));
+
+            dump.count = 0;
+            stimer_prof_visit(prof, &dump, mock_visit);
+            assert_equal(4, dump.count);
+            assert_equal(3, dump.records[0].calls);
+            assert_equal(13, dump.records[3].exclusive_ticks);
+        }
+
+        it("can be reset") {
+            stimer_prof_reset(prof);
+            assert_equal(0, stimer_prof_get_dropped(prof));
+
+            dump.count = 0;
+            stimer_prof_visit(prof, &dump, mock_visit);
+            assert_equal(4, dump.count);
+            assert_equal(0, dump.records[0].calls);
+            assert_equal(0, dump.records[3].inclusive_ticks);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_prof(prof);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "describe/describe.h"
+
+#include "stimer/stimer_pt.h"
+
+
+// Minimal switch based protothreads, as in pt.h
+struct pt {
+    unsigned int lc;
+};
+
+#define PT_WAITING      0
+#define PT_ENDED        3
+
+#define PT_INIT(pt)             (pt)->lc = 0
+#define PT_BEGIN(pt)            switch ((pt)->lc) { case 0:
+#define PT_END(pt)              } PT_INIT(pt); return PT_ENDED
+// The resume point is meant to be fallen into
+#if defined(__GNUC__) && (__GNUC__ >= 7)
+#define PT_FALLTHROUGH          __attribute__((fallthrough))
+#else
+#define PT_FALLTHROUGH
+#endif
+
+#define PT_WAIT_UNTIL(pt, c)                                                    \
+    do {                                                                        \
+        (pt)->lc = __LINE__; PT_FALLTHROUGH; case __LINE__:                     \
+        if (!(c)) {                                                             \
+            return PT_WAITING;                                                  \
+        }                                                                       \
+    } while (0)
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+struct blinker {
+    struct pt pt;
+    struct stimer_deadline deadline;
+    struct stimer_ctx * ctx;
+    int toggles;
+};
+
+
+static int
+blinker_thread(struct blinker * b)
+{
+    PT_BEGIN(&b->pt);
+    for (;;) {
+        STIMER_PT_WAIT_MS(&b->pt, b->ctx, &b->deadline, 10);
+        b->toggles += 1;
+    }
+    PT_END(&b->pt);
+}
+
+
+struct ticker {
+    struct pt pt;
+    struct stimer_deadline deadline;
+    struct stimer_ctx * ctx;
+    int ticks;
+};
+
+
+static int
+ticker_thread(struct ticker * t)
+{
+    PT_BEGIN(&t->pt);
+    stimer_deadline_from_now_ms(&t->deadline, t->ctx, 0);
+    for (;;) {
+        STIMER_PT_WAIT_PERIOD_MS(&t->pt, &t->deadline, 10);
+        t->ticks += 1;
+    }
+    PT_END(&t->pt);
+}
+
+
+struct waiter {
+    struct pt pt;
+    struct stimer_deadline deadline;
+    struct stimer_ctx * ctx;
+    bool flag;
+    bool is_timed_out;
+};
+
+
+static int
+waiter_thread(struct waiter * w)
+{
+    PT_BEGIN(&w->pt);
+    STIMER_PT_WAIT_UNTIL_MS(&w->pt, w->ctx, &w->deadline, 20, w->flag);
+    w->is_timed_out = stimer_deadline_is_expired(&w->deadline);
+    PT_END(&w->pt);
+}
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("Protothread wait macros") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct blinker b;
+        struct ticker t;
+        struct waiter w;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            PT_INIT(&b.pt);
+            b.ctx = ctx;
+            b.toggles = 0;
+
+            PT_INIT(&t.pt);
+            t.ctx = ctx;
+            t.ticks = 0;
+
+            PT_INIT(&w.pt);
+            w.ctx = ctx;
+            w.flag = false;
+            w.is_timed_out = false;
+        }
+
+        it("waits a number of milliseconds") {
+            uint32_t i;
+            for (i = 0; i < 35; ++i) {
+                assert_equal(PT_WAITING, blinker_thread(&b));
+                current_time = (current_time + 1) & 0xFF;
+            }
+            assert_equal(PT_WAITING, blinker_thread(&b));
+            assert_equal(3, b.toggles);
+        }
+
+        it("waits for steady periods") {
+            assert_equal(PT_WAITING, ticker_thread(&t));
+
+            // Polled late, but the periods stay on the 10ms grid
+            current_time = (current_time + 13) & 0xFF;
+            assert_equal(PT_WAITING, ticker_thread(&t));
+            assert_equal(1, t.ticks);
+
+            current_time = (current_time + 6) & 0xFF;
+            assert_equal(PT_WAITING, ticker_thread(&t));
+            assert_equal(1, t.ticks);
+
+            current_time = (current_time + 1) & 0xFF;
+            assert_equal(PT_WAITING, ticker_thread(&t));
+            assert_equal(2, t.ticks);
+        }
+
+        it("waits for a condition with a timeout") {
+            assert_equal(PT_WAITING, waiter_thread(&w));
+            current_time = (current_time + 5) & 0xFF;
+            assert_equal(PT_WAITING, waiter_thread(&w));
+
+            w.flag = true;
+            assert_equal(PT_ENDED, waiter_thread(&w));
+            assert_equal(false, w.is_timed_out);
+
+            w.flag = false;
+            assert_equal(PT_WAITING, waiter_thread(&w));
+            current_time = (current_time + 20) & 0xFF;
+            assert_equal(PT_ENDED, waiter_thread(&w));
+            assert_equal(true, w.is_timed_out);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    return 0;
+}
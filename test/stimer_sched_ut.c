@@ -0,0 +1,203 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "describe/describe.h"
+
+#include "stimer/stimer_sched.h"
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+struct mock_task {
+    struct stimer_task * task;
+    char * log;
+    char name;
+    int calls;
+    bool free_task;
+};
+
+
+static void
+mock_task(void * hint)
+{
+    struct mock_task * mt = (struct mock_task *) hint;
+    mt->calls += 1;
+
+    // Append the task name to the run log
+    char * end = mt->log;
+    while ('\0' != *end) {
+        ++end;
+    }
+    end[0] = mt->name;
+    end[1] = '\0';
+
+    if (mt->free_task) {
+        stimer_free_task(mt->task);
+        mt->task = NULL;
+    }
+}
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("Task scheduler") {
+        struct stimer_ctx * ctx = NULL;
+        struct stimer_sched * sched = NULL;
+        uint32_t current_time = 0;
+        char log[64] = "";
+
+        struct mock_task a = { NULL, log, 'a', 0, false };
+        struct mock_task b = { NULL, log, 'b', 0, false };
+        struct mock_task c = { NULL, log, 'c', 0, false };
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            sched = stimer_alloc_sched(ctx);
+            assert_not_null(sched);
+
+            a.task = stimer_alloc_task(sched, 2, mock_task, &a);
+            assert_not_null(a.task);
+
+            b.task = stimer_alloc_task(sched, 0, mock_task, &b);
+            assert_not_null(b.task);
+
+            c.task = stimer_alloc_task(sched, 1, mock_task, &c);
+            assert_not_null(c.task);
+        }
+
+        it("rejects an invalid priority") {
+            assert_null(stimer_alloc_task(sched, STIMER_SCHED_PRIORITIES, mock_task, NULL));
+        }
+
+        it("does not run idle tasks") {
+            current_time = 5;
+            assert_equal(0, stimer_sched_run(sched));
+            assert_equal(0, a.calls + b.calls + c.calls);
+        }
+
+        it("runs due tasks highest priority first") {
+            stimer_task_after_ms(a.task, 10);
+            stimer_task_after_ms(b.task, 10);
+            stimer_task_after_ms(c.task, 10);
+
+            current_time = 14;
+            assert_equal(0, stimer_sched_run(sched));
+
+            current_time = 15;
+            assert_equal(3, stimer_sched_run(sched));
+            assert_equal(0, strcmp("bca", log));
+        }
+
+        it("runs one shot tasks once") {
+            current_time = 30;
+            assert_equal(0, stimer_sched_run(sched));
+            assert_equal(1, a.calls);
+        }
+
+        it("runs periodic tasks at their rates") {
+            log[0] = '\0';
+            a.calls = 0;
+            b.calls = 0;
+            c.calls = 0;
+
+            stimer_task_every_ms(a.task, 2);
+            stimer_task_every_ms(b.task, 5);
+
+            uint32_t i;
+            for (i = 0; i < 20; ++i) {
+                current_time += 1;
+                (void) stimer_sched_run(sched);
+            }
+            assert_equal(10, a.calls);
+            assert_equal(4, b.calls);
+            assert_equal(0, c.calls);
+        }
+
+        it("catches up on missed periods one run at a time") {
+            stimer_task_cancel(b.task);
+            a.calls = 0;
+
+            // Three periods of a are missed
+            current_time += 6;
+            assert_equal(1, stimer_sched_run(sched));
+            assert_equal(1, stimer_sched_run(sched));
+            assert_equal(1, stimer_sched_run(sched));
+            assert_equal(0, stimer_sched_run(sched));
+            assert_equal(3, a.calls);
+        }
+
+        it("does not run cancelled tasks") {
+            a.calls = 0;
+            b.calls = 0;
+
+            // Cancel a task that is already due
+            stimer_task_after_ms(c.task, 1);
+            current_time += 2;
+            stimer_execute_context(ctx);
+            stimer_task_cancel(c.task);
+
+            c.calls = 0;
+            current_time += 10;
+            (void) stimer_sched_run(sched);
+            assert_equal(0, b.calls);
+            assert_equal(0, c.calls);
+            assert_not_equal(0, a.calls);
+        }
+
+        it("lets a task free itself") {
+            stimer_task_cancel(a.task);
+            a.calls = 0;
+            a.free_task = true;
+            stimer_task_after_ms(a.task, 1);
+            stimer_task_after_ms(c.task, 1);
+
+            current_time += 1;
+            assert_equal(2, stimer_sched_run(sched));
+            assert_equal(1, a.calls);
+            assert_null(a.task);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_sched(sched);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    return 0;
+}
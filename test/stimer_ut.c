@@ -23,6 +23,7 @@
 #include "describe/describe.h"
 
 #include "stimer/stimer.h"
+#include "stimer/stimer_private.h"
 
 
 static uint32_t
@@ -36,6 +37,40 @@ mock_get_time(void * hint)
 }
 
 
+struct mock_alarm {
+    uint32_t alarm_time;
+    int calls;
+};
+
+
+static void
+mock_set_alarm(void * hint, uint32_t alarm_time)
+{
+    struct mock_alarm * alarm = (struct mock_alarm *) hint;
+    alarm->alarm_time = alarm_time;
+    alarm->calls += 1;
+}
+
+
+struct mock_expire {
+    struct stimer * last;
+    int calls;
+    bool free_timer;
+};
+
+
+static void
+mock_expire(void * hint, struct stimer * ts)
+{
+    struct mock_expire * expire = (struct mock_expire *) hint;
+    expire->last = ts;
+    expire->calls += 1;
+    if (expire->free_timer) {
+        stimer_free(ts);
+    }
+}
+
+
 int main(int argc, char const *argv[])
 {
     (void) argc;
@@ -68,6 +103,48 @@ int main(int argc, char const *argv[])
         }
     }
 
+
+    describe("Timer context freed first") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_duration td;
+
+        struct stimer * t1 = NULL;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            stimer_expire_from_now_ms(t1, 10);
+            current_time = 4;
+            assert_equal(4, stimer_get_elapsed_ticks(t1));
+        }
+
+        it("reports no elapsed or remaining time from every getter") {
+            stimer_free_context(ctx);
+
+            stimer_get_elapsed_time(t1, &td);
+            assert_equal(0, td.seconds);
+            assert_equal(0, td.nanoseconds);
+            assert_equal(0, stimer_get_elapsed_ticks(t1));
+            assert_equal(0, stimer_get_elapsed_ns64(t1));
+
+            assert_equal(true, stimer_get_remaining_time(t1, &td));
+            assert_equal(0, td.seconds);
+            assert_equal(0, td.nanoseconds);
+            assert_equal(true, stimer_is_expired(t1));
+            assert_equal(0, stimer_get_remaining_ticks(t1));
+            assert_equal(0, stimer_get_remaining_ns64(t1));
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free(t1);
+        }
+    }
+
     describe("Timer elapse math") {
         struct stimer_ctx * ctx = NULL;
         uint32_t current_time = 0;
@@ -292,6 +369,265 @@ int main(int argc, char const *argv[])
             assert_equal(true, stimer_is_expired(t2));
         }
 
+        it("can lazily restart kicked timers") {
+            stimer_expire_from_now_ms(t1, 5);
+            stimer_expire_from_now_ms(t2, 5);
+
+            current_time += 3;
+            stimer_execute_context(ctx);
+            stimer_kick(t1);
+
+            current_time += 2;
+            assert_equal(false, stimer_is_expired(t1));
+            assert_equal(true, stimer_is_expired(t2));
+            assert_equal(2, stimer_get_elapsed_ticks(t1));
+
+            current_time += 2;
+            stimer_execute_context(ctx);
+            stimer_kick(t1);
+
+            current_time += 3;
+            assert_equal(false, stimer_is_expired(t1));
+
+            current_time += 2;
+            assert_equal(true, stimer_is_expired(t1));
+        }
+
+        it("reads the clock when kicking a timer") {
+            stimer_expire_from_now_ms(t1, 5);
+
+            current_time += 3;
+            stimer_kick(t1);
+
+            current_time += 4;
+            assert_equal(false, stimer_is_expired(t1));
+            assert_equal(4, stimer_get_elapsed_ticks(t1));
+
+            current_time += 1;
+            assert_equal(true, stimer_is_expired(t1));
+        }
+
+        it("kicks at an already read context time") {
+            stimer_expire_from_now_ms(t1, 5);
+
+            current_time += 3;
+            uint64_t ticks = stimer_get_context_ticks(ctx);
+            current_time += 1;
+            assert_equal(true, stimer_kick_at(t1, ticks));
+
+            current_time += 3;
+            assert_equal(false, stimer_is_expired(t1));
+            assert_equal(4, stimer_get_elapsed_ticks(t1));
+
+            current_time += 1;
+            assert_equal(true, stimer_is_expired(t1));
+        }
+
+        it("moves an expired timer when it is kicked") {
+            struct mock_expire expire = { NULL, 0, false };
+            stimer_set_expire_callback(t1, &expire, mock_expire);
+            stimer_expire_from_now_ms(t1, 5);
+
+            current_time += 5;
+            stimer_execute_context(ctx);
+            assert_equal(1, expire.calls);
+
+            current_time += 2;
+            stimer_kick(t1);
+
+            current_time += 4;
+            stimer_execute_context(ctx);
+            assert_equal(1, expire.calls);
+
+            current_time += 1;
+            stimer_execute_context(ctx);
+            assert_equal(2, expire.calls);
+            stimer_set_expire_callback(t1, NULL, NULL);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free(t2);
+            stimer_free(t1);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    describe("Timer tick conversion") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+
+        struct stimer * t1 = NULL;
+        struct stimer * t2 = NULL;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            t2 = stimer_alloc(ctx);
+            assert_not_null(t2);
+        }
+
+        it("can expire timers in ticks") {
+            stimer_expire_from_now_ticks(t1, 2);
+            stimer_expire_from_now_us(t2, 1001);
+
+            current_time += 1;
+            assert_equal(false, stimer_is_expired(t1));
+            assert_equal(false, stimer_is_expired(t2));
+
+            current_time += 1;
+            assert_equal(true, stimer_is_expired(t1));
+            assert_equal(true, stimer_is_expired(t2));
+        }
+
+        it("does not drift when advancing partial tick intervals") {
+            stimer_expire_from_now_us(t1, 1500);
+
+            int expired_at[4];
+            int n = 0;
+            int i;
+            for (i = 1; (i <= 6) && (n < 4); ++i) {
+                current_time += 1;
+                if (stimer_is_expired(t1)) {
+                    expired_at[n++] = i;
+                    stimer_advance(t1);
+                }
+            }
+
+            assert_equal(4, n);
+            assert_equal(2, expired_at[0]);
+            assert_equal(3, expired_at[1]);
+            assert_equal(5, expired_at[2]);
+            assert_equal(6, expired_at[3]);
+
+            struct stimer_duration td;
+            stimer_get_elapsed_time(t1, &td);
+            assert_equal(0, td.seconds);
+            assert_equal(0, td.nanoseconds);
+        }
+
+        it("can query elapsed and remaining time without conversion") {
+            stimer_expire_from_now_us(t1, 2500);
+            assert_equal(0, stimer_get_elapsed_ticks(t1));
+            assert_equal(3, stimer_get_remaining_ticks(t1));
+            assert_equal(2500000, stimer_get_remaining_ns64(t1));
+
+            current_time += 2;
+            assert_equal(2, stimer_get_elapsed_ticks(t1));
+            assert_equal(2000000, stimer_get_elapsed_ns64(t1));
+            assert_equal(1, stimer_get_remaining_ticks(t1));
+            assert_equal(500000, stimer_get_remaining_ns64(t1));
+
+            current_time += 1;
+            assert_equal(true, stimer_is_expired(t1));
+            assert_equal(0, stimer_get_remaining_ticks(t1));
+            assert_equal(0, stimer_get_remaining_ns64(t1));
+
+            stimer_advance(t1);
+            assert_equal(500000, stimer_get_elapsed_ns64(t1));
+            assert_equal(2000000, stimer_get_remaining_ns64(t1));
+        }
+
+        it("can query remaining time together with expiration") {
+            struct stimer_duration td;
+            stimer_expire_from_now_ms(t2, 1500);
+
+            assert_equal(false, stimer_get_remaining_time(t2, &td));
+            assert_equal(1, td.seconds);
+            assert_equal(500000000, td.nanoseconds);
+
+            current_time += 100;
+            assert_equal(false, stimer_get_remaining_time(t2, &td));
+            assert_equal(1, td.seconds);
+            assert_equal(400000000, td.nanoseconds);
+
+            int i;
+            for (i = 0; i < 1400; ++i) {
+                current_time += 1;
+                stimer_execute_context(ctx);
+            }
+            assert_equal(true, stimer_get_remaining_time(t2, &td));
+            assert_equal(0, td.seconds);
+            assert_equal(0, td.nanoseconds);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free(t2);
+            stimer_free(t1);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    describe("Timer alarm") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct mock_alarm alarm = { 0, 0 };
+
+        struct stimer * t1 = NULL;
+        struct stimer * t2 = NULL;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            t2 = stimer_alloc(ctx);
+            assert_not_null(t2);
+        }
+
+        it("programs the rollover horizon when idle") {
+            current_time = 0xF0;
+            stimer_set_alarm_callback(ctx, &alarm, mock_set_alarm);
+            assert_equal(1, alarm.calls);
+            assert_equal(0x2F, alarm.alarm_time);
+        }
+
+        it("pulls the alarm in when a timer is armed") {
+            stimer_expire_from_now_ms(t1, 20);
+            assert_equal(2, alarm.calls);
+            assert_equal(0x04, alarm.alarm_time);
+
+            stimer_expire_from_now_ms(t2, 5);
+            assert_equal(3, alarm.calls);
+            assert_equal(0xF5, alarm.alarm_time);
+
+            stimer_expire_from_now_ms(t1, 10);
+            assert_equal(3, alarm.calls);
+        }
+
+        it("moves the alarm out on execute") {
+            current_time = 0xF5;
+            stimer_execute_context(ctx);
+            assert_equal(true, stimer_is_expired(t2));
+            assert_equal(0xFA, alarm.alarm_time);
+
+            stimer_stop(t1);
+            current_time = 0xF6;
+            stimer_execute_context(ctx);
+            assert_equal(0x35, alarm.alarm_time);
+        }
+
+        it("only calls the callback when the alarm moves") {
+            stimer_expire_from_now_ms(t1, 10);
+            int calls = alarm.calls;
+            assert_equal(0x00, alarm.alarm_time);
+
+            uint32_t i;
+            for (i = 0; i < 5; ++i) {
+                current_time += 1;
+                stimer_execute_context(ctx);
+            }
+            assert_equal(calls, alarm.calls);
+            assert_equal(0x00, alarm.alarm_time);
+        }
+
         it("test objects can be deallocated") {
             stimer_free(t2);
             stimer_free(t1);
@@ -300,5 +636,984 @@ int main(int argc, char const *argv[])
     }
 
 
+    describe("Timer budgeted execute") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+
+        struct stimer * t1 = NULL;
+        struct stimer * t2 = NULL;
+        struct stimer * t3 = NULL;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            t2 = stimer_alloc(ctx);
+            assert_not_null(t2);
+
+            t3 = stimer_alloc(ctx);
+            assert_not_null(t3);
+        }
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_LIST
+        it("resumes where the previous call left off") {
+            stimer_start(t1);
+            stimer_start(t2);
+            stimer_start(t3);
+
+            assert_equal(false, stimer_execute_context_budget(ctx, 2));
+            assert_equal(true, stimer_execute_context_budget(ctx, 2));
+            assert_equal(false, stimer_execute_context_budget(ctx, 1));
+
+            stimer_free(t2);
+            assert_equal(true, stimer_execute_context_budget(ctx, 1));
+        }
+#else
+        it("only counts expired timers against the budget") {
+            stimer_expire_from_now_ms(t1, 1);
+            stimer_expire_from_now_ms(t2, 1);
+            stimer_expire_from_now_ms(t3, 2);
+
+            current_time = 1;
+            assert_equal(false, stimer_execute_context_budget(ctx, 1));
+            assert_equal(true, stimer_execute_context_budget(ctx, 1));
+            assert_equal(false, stimer_is_expired(t3));
+
+            current_time = 2;
+            assert_equal(true, stimer_execute_context_budget(ctx, 1));
+            assert_equal(true, stimer_is_expired(t3));
+
+            stimer_free(t2);
+            stimer_start(t1);
+            stimer_start(t3);
+        }
+#endif
+
+        it("keeps timers running across budgeted passes") {
+            int i;
+            for (i = 0; i < 1000; ++i) {
+                current_time += 1;
+                stimer_execute_context_budget(ctx, 1);
+            }
+
+            struct stimer_duration td;
+            stimer_get_elapsed_time(t1, &td);
+            assert_equal(1, td.seconds);
+            assert_equal(0, td.nanoseconds);
+
+            stimer_get_elapsed_time(t3, &td);
+            assert_equal(1, td.seconds);
+            assert_equal(0, td.nanoseconds);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free(t3);
+            stimer_free(t1);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    describe("Timer interval class") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct mock_alarm alarm = { 0, 0 };
+
+        struct stimer_class * cls = NULL;
+        struct stimer * t1 = NULL;
+        struct stimer * t2 = NULL;
+        struct stimer * t3 = NULL;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            struct stimer_duration td;
+            td.seconds = 0;
+            td.nanoseconds = 10000000;
+            cls = stimer_alloc_class(ctx, &td);
+            assert_not_null(cls);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            t2 = stimer_alloc(ctx);
+            assert_not_null(t2);
+
+            t3 = stimer_alloc(ctx);
+            assert_not_null(t3);
+
+            stimer_set_alarm_callback(ctx, &alarm, mock_set_alarm);
+        }
+
+        it("expires timers in arming order") {
+            stimer_expire_from_now_class(t1, cls);
+            assert_equal(10, alarm.alarm_time);
+
+            current_time += 2;
+            stimer_expire_from_now_class(t2, cls);
+            current_time += 2;
+            stimer_expire_from_now_class(t3, cls);
+
+            current_time = 10;
+            stimer_execute_context(ctx);
+            assert_equal(true, stimer_is_expired(t1));
+            assert_equal(false, stimer_is_expired(t2));
+            assert_equal(12, alarm.alarm_time);
+        }
+
+        it("keeps restarted and kicked timers in order") {
+            stimer_restart_from_now(t2);
+            stimer_execute_context(ctx);
+            assert_equal(14, alarm.alarm_time);
+
+            current_time = 12;
+            stimer_execute_context(ctx);
+            stimer_kick(t3);
+
+            current_time = 14;
+            stimer_execute_context(ctx);
+            assert_equal(false, stimer_is_expired(t3));
+            assert_equal(20, alarm.alarm_time);
+
+            current_time = 20;
+            stimer_execute_context(ctx);
+            assert_equal(true, stimer_is_expired(t2));
+            assert_equal(false, stimer_is_expired(t3));
+            assert_equal(22, alarm.alarm_time);
+        }
+
+        it("drops timers armed outside of the class") {
+            stimer_expire_from_now_ms(t3, 1);
+            stimer_stop(t1);
+            stimer_free(t2);
+            t2 = NULL;
+
+            current_time = 21;
+            stimer_execute_context(ctx);
+            assert_equal(true, stimer_is_expired(t3));
+            assert_equal(21 + 0x3F, alarm.alarm_time);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_expire_from_now_class(t1, cls);
+            stimer_free_context(ctx);
+            stimer_free_class(cls);
+            stimer_free(t3);
+            stimer_free(t1);
+        }
+    }
+
+
+    describe("Timer interval class budgeted execute") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+
+        struct stimer_class * cls = NULL;
+        struct stimer * timers[5];
+        int i;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            struct stimer_duration td;
+            td.seconds = 0;
+            td.nanoseconds = 10000000;
+            cls = stimer_alloc_class(ctx, &td);
+            assert_not_null(cls);
+
+            for (i = 0; i < 5; ++i) {
+                timers[i] = stimer_alloc(ctx);
+                assert_not_null(timers[i]);
+            }
+        }
+
+        it("counts expired class timers against the budget") {
+            for (i = 0; i < 5; ++i) {
+                stimer_expire_from_now_class(timers[i], cls);
+            }
+
+            current_time = 10;
+            assert_equal(0, stimer_get_ticks_until_next(ctx));
+            assert_equal(false, stimer_execute_context_budget(ctx, 2));
+            assert_equal(0, stimer_get_ticks_until_next(ctx));
+            assert_equal(false, stimer_execute_context_budget(ctx, 2));
+
+            // The list backend also walks the timers that left the class
+            for (i = 0; i < 5; ++i) {
+                if (stimer_execute_context_budget(ctx, 2)) {
+                    break;
+                }
+            }
+            assert_not_equal(5, i);
+
+            for (i = 0; i < 5; ++i) {
+                assert_equal(true, stimer_is_expired(timers[i]));
+            }
+            assert_equal(0x3F, stimer_get_ticks_until_next(ctx));
+        }
+
+        it("test objects can be deallocated") {
+            for (i = 0; i < 5; ++i) {
+                stimer_free(timers[i]);
+            }
+            stimer_free_class(cls);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    describe("Timer next expiration") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+
+        struct stimer * timers[16];
+        uint64_t deadlines[16];
+        uint64_t now = 0;
+        uint32_t seed = 1;
+        int i;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFFFF, 1000000);
+            assert_not_null(ctx);
+
+            for (i = 0; i < 16; ++i) {
+                timers[i] = stimer_alloc(ctx);
+                assert_not_null(timers[i]);
+            }
+        }
+
+        it("reports the rollover horizon when idle") {
+            assert_equal(0x3FFF, stimer_get_ticks_until_next(ctx));
+        }
+
+        it("reports the earliest expiration") {
+            stimer_expire_from_now_ms(timers[1], 9);
+            stimer_expire_from_now_ms(timers[0], 5);
+            assert_equal(5, stimer_get_ticks_until_next(ctx));
+
+            stimer_stop(timers[1]);
+            current_time = 5;
+            stimer_execute_context(ctx);
+            assert_equal(true, stimer_is_expired(timers[0]));
+            assert_equal(0x3FFF, stimer_get_ticks_until_next(ctx));
+            now = 5;
+        }
+
+        it("reports expirations that were not executed yet") {
+            stimer_expire_from_now_ms(timers[0], 5);
+
+            current_time = 12;
+            assert_equal(0, stimer_get_ticks_until_next(ctx));
+            assert_equal(true, stimer_is_expired(timers[0]));
+            assert_equal(0, stimer_get_ticks_until_next(ctx));
+
+            stimer_execute_context(ctx);
+            assert_equal(0x3FFF, stimer_get_ticks_until_next(ctx));
+            now = 12;
+        }
+
+        it("forgets the expiration of restarted stopwatches") {
+            stimer_expire_from_now_ms(timers[0], 5);
+            assert_equal(5, stimer_get_ticks_until_next(ctx));
+
+            stimer_start(timers[0]);
+            assert_equal(0x3FFF, stimer_get_ticks_until_next(ctx));
+            stimer_stop(timers[0]);
+        }
+
+        it("follows the earliest expiration when it is re-armed") {
+            stimer_expire_from_now_ms(timers[0], 30);
+            stimer_expire_from_now_ms(timers[1], 20);
+            stimer_expire_from_now_ms(timers[2], 10);
+            assert_equal(10, stimer_get_ticks_until_next(ctx));
+
+            stimer_expire_from_now_ms(timers[2], 5);
+            assert_equal(5, stimer_get_ticks_until_next(ctx));
+
+            stimer_expire_from_now_ms(timers[2], 25);
+            assert_equal(20, stimer_get_ticks_until_next(ctx));
+
+            stimer_stop(timers[1]);
+            assert_equal(25, stimer_get_ticks_until_next(ctx));
+
+            stimer_expire_from_now_ms(timers[1], 2);
+            assert_equal(2, stimer_get_ticks_until_next(ctx));
+
+            for (i = 0; i < 3; ++i) {
+                stimer_stop(timers[i]);
+            }
+            assert_equal(0x3FFF, stimer_get_ticks_until_next(ctx));
+        }
+
+        it("wakes up exactly when timers expire") {
+            for (i = 0; i < 16; ++i) {
+                seed = (seed * 1103515245u) + 12345u;
+                uint32_t ms = 1 + ((seed >> 8) % 100000u);
+                stimer_expire_from_now_ms(timers[i], ms);
+                deadlines[i] = now + ms;
+            }
+
+            int expired = 0;
+            int wakeups = 0;
+            while ((expired < 200) && (wakeups < 10000)) {
+                uint32_t ticks = stimer_get_ticks_until_next(ctx);
+                assert_equal(true, ticks > 0);
+
+                now += ticks;
+                current_time = (uint32_t) (now & 0xFFFF);
+                stimer_execute_context(ctx);
+                ++wakeups;
+
+                for (i = 0; i < 16; ++i) {
+                    assert_equal(true, now <= deadlines[i]);
+                    assert_equal(now == deadlines[i], stimer_is_expired(timers[i]));
+
+                    if (now == deadlines[i]) {
+                        // Re-arm, sometimes further out than the horizon
+                        seed = (seed * 1103515245u) + 12345u;
+                        uint32_t ms = 1 + ((seed >> 8) % 100000u);
+                        stimer_expire_from_now_ms(timers[i], ms);
+                        deadlines[i] = now + ms;
+                        ++expired;
+                    }
+                }
+            }
+            assert_equal(200, expired);
+        }
+
+        it("test objects can be deallocated") {
+            for (i = 0; i < 16; ++i) {
+                stimer_free(timers[i]);
+            }
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    describe("Timer expire callback") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct mock_expire expire = { NULL, 0, false };
+
+        struct stimer * t1 = NULL;
+        struct stimer * t2 = NULL;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            t2 = stimer_alloc(ctx);
+            assert_not_null(t2);
+
+            assert_equal(true, stimer_set_expire_callback(t1, &expire, mock_expire));
+            assert_equal(true, stimer_set_expire_callback(t2, &expire, mock_expire));
+        }
+
+        it("reports each expiration once") {
+            stimer_expire_from_now_ms(t1, 10);
+            stimer_expire_from_now_ms(t2, 20);
+
+            current_time = 9;
+            stimer_execute_context(ctx);
+            assert_equal(0, expire.calls);
+
+            current_time = 10;
+            stimer_execute_context(ctx);
+            assert_equal(1, expire.calls);
+            assert_equal(t1, expire.last);
+
+            current_time = 11;
+            stimer_execute_context(ctx);
+            assert_equal(1, expire.calls);
+        }
+
+        it("reports again after advancing") {
+            stimer_advance(t1);
+            current_time = 20;
+            stimer_execute_context(ctx);
+            assert_equal(3, expire.calls);
+
+            stimer_stop(t1);
+            current_time = 30;
+            stimer_execute_context(ctx);
+            assert_equal(3, expire.calls);
+        }
+
+        it("lets the callback free the timer") {
+            expire.free_timer = true;
+            stimer_advance(t2);
+            current_time = 40;
+            stimer_execute_context(ctx);
+            assert_equal(4, expire.calls);
+            assert_equal(t2, expire.last);
+            t2 = NULL;
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free(t1);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    describe("Timer long deadlines") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+
+        struct stimer * t1 = NULL;
+        struct stimer * t2 = NULL;
+
+        it("test objects can be allocated") {
+            // 1ns per count, so seconds are more than 32 bits of ticks
+            ctx = stimer_alloc_context(&current_time, mock_get_time, UINT32_MAX, 1);
+            assert_not_null(ctx);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            t2 = stimer_alloc(ctx);
+            assert_not_null(t2);
+        }
+
+        it("expires timers more than 32 bits of ticks out") {
+            stimer_expire_from_now_s(t1, 10);
+            stimer_expire_from_now_s(t2, 5);
+
+            uint64_t now = 0;
+            while (now < 10000000000ull) {
+                uint32_t ticks = stimer_get_ticks_until_next(ctx);
+                assert_equal(true, ticks > 0);
+
+                now += ticks;
+                current_time = (uint32_t) now;
+                stimer_execute_context(ctx);
+
+                assert_equal(now >= 5000000000ull, stimer_is_expired(t2));
+                assert_equal(now >= 10000000000ull, stimer_is_expired(t1));
+            }
+            assert_equal(10000000000ull, now);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free(t2);
+            stimer_free(t1);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    describe("Stopwatch") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_stopwatch sw;
+        struct stimer_duration td;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+        }
+
+        it("can track elapsed time") {
+            current_time = 10;
+            stimer_stopwatch_start(&sw, ctx);
+            assert_equal(0, stimer_stopwatch_get_elapsed_ticks(&sw));
+
+            current_time = 0x10;
+            assert_equal(6, stimer_stopwatch_get_elapsed_ticks(&sw));
+            assert_equal(6000000, stimer_stopwatch_get_elapsed_ns64(&sw));
+
+            stimer_stopwatch_get_elapsed_time(&sw, &td);
+            assert_equal(0, td.seconds);
+            assert_equal(6000000, td.nanoseconds);
+        }
+
+        it("keeps time across get_time_fn rollovers") {
+            uint32_t i;
+            for (i = 0; i < 1000; ++i) {
+                current_time = (current_time + 1) & 0xFF;
+                (void) stimer_get_context_ticks(ctx);
+            }
+
+            stimer_stopwatch_get_elapsed_time(&sw, &td);
+            assert_equal(1, td.seconds);
+            assert_equal(6000000, td.nanoseconds);
+        }
+
+        it("loses no time between laps") {
+            stimer_stopwatch_start(&sw, ctx);
+
+            current_time = (current_time + 3) & 0xFF;
+            assert_equal(3, stimer_stopwatch_lap_ticks(&sw));
+            current_time = (current_time + 4) & 0xFF;
+            assert_equal(4, stimer_stopwatch_lap_ticks(&sw));
+            assert_equal(0, stimer_stopwatch_get_elapsed_ticks(&sw));
+        }
+
+        it("is not visited by the context") {
+            assert_equal(NULL, ctx->root);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_context(ctx);
+        }
+    }
+
+    describe("Deadline") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_deadline outer;
+        struct stimer_deadline inner;
+        struct stimer_duration td;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+        }
+
+        it("counts down to the deadline") {
+            stimer_deadline_from_now_ms(&outer, ctx, 50);
+            assert_equal(false, stimer_deadline_is_expired(&outer));
+            assert_equal(50, stimer_deadline_get_remaining_ticks(&outer));
+
+            current_time = 20;
+            assert_equal(false, stimer_deadline_get_remaining_time(&outer, &td));
+            assert_equal(0, td.seconds);
+            assert_equal(30000000, td.nanoseconds);
+        }
+
+        it("can be shrunk by an inner timeout") {
+            inner = outer;
+            stimer_deadline_limit_ms(&inner, 10);
+            assert_equal(10, stimer_deadline_get_remaining_ticks(&inner));
+
+            inner = outer;
+            stimer_deadline_limit_ms(&inner, 100);
+            assert_equal(30, stimer_deadline_get_remaining_ticks(&inner));
+
+            stimer_deadline_never(&inner, ctx);
+            assert_equal(UINT64_MAX, stimer_deadline_get_remaining_ticks(&inner));
+            inner = stimer_deadline_min(inner, outer);
+            assert_equal(30, stimer_deadline_get_remaining_ticks(&inner));
+        }
+
+        it("expires at the deadline") {
+            current_time = 49;
+            assert_equal(false, stimer_deadline_is_expired(&outer));
+
+            current_time = 50;
+            assert_equal(true, stimer_deadline_is_expired(&outer));
+            assert_equal(true, stimer_deadline_get_remaining_time(&outer, &td));
+            assert_equal(0, td.seconds);
+            assert_equal(0, td.nanoseconds);
+        }
+
+        it("advances from the previous deadline") {
+            current_time = 53;
+            stimer_deadline_advance_ms(&outer, 10);
+            current_time = 59;
+            assert_equal(false, stimer_deadline_is_expired(&outer));
+            current_time = 60;
+            assert_equal(true, stimer_deadline_is_expired(&outer));
+
+            stimer_deadline_never(&inner, ctx);
+            stimer_deadline_advance_ms(&inner, 10);
+            assert_equal(UINT64_MAX, stimer_deadline_get_remaining_ticks(&inner));
+        }
+
+        it("does not drift with intervals that are not whole ticks") {
+            struct stimer_ctx * slow_ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 300000);
+            assert_not_null(slow_ctx);
+
+            // 1ms is 3.33 ticks of 0.3ms. 100 periods end at tick 334, not 400
+            stimer_deadline_from_now_ms(&inner, slow_ctx, 0);
+            uint32_t i;
+            for (i = 0; i < 100; ++i) {
+                stimer_deadline_advance_ms(&inner, 1);
+            }
+
+            for (i = 0; i < 334; ++i) {
+                assert_equal(false, stimer_deadline_is_expired(&inner));
+                current_time = (current_time + 1) & 0xFF;
+            }
+            assert_equal(true, stimer_deadline_is_expired(&inner));
+
+            stimer_free_context(slow_ctx);
+        }
+
+        it("keeps time across get_time_fn rollovers") {
+            stimer_deadline_from_now_ms(&outer, ctx, 1000);
+
+            uint32_t i;
+            for (i = 0; i < 999; ++i) {
+                current_time = (current_time + 1) & 0xFF;
+                assert_equal(false, stimer_deadline_is_expired(&outer));
+            }
+            current_time = (current_time + 1) & 0xFF;
+            assert_equal(true, stimer_deadline_is_expired(&outer));
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_context(ctx);
+        }
+    }
+
+    describe("Timer statistics") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_stats stats;
+
+        struct stimer * t1 = NULL;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            stimer_stats_reset(&stats);
+            assert_equal(true, stimer_set_stats(t1, &stats));
+            assert_equal(0, stimer_stats_get_mean_ticks(&stats));
+        }
+
+        it("records every start/stop cycle") {
+            uint32_t i;
+            for (i = 1; i <= 4; ++i) {
+                stimer_start(t1);
+                current_time += i;
+                stimer_stop(t1);
+            }
+
+            // Stopping a stopped timer is not a sample
+            stimer_stop(t1);
+
+            assert_equal(4, stats.count);
+            assert_equal(10, stats.total_ticks);
+            assert_equal(1, stats.min_ticks);
+            assert_equal(4, stats.max_ticks);
+            assert_equal(2, stimer_stats_get_mean_ticks(&stats));
+
+            assert_equal(0, stats.histogram[0]);
+            assert_equal(1, stats.histogram[1]);
+            assert_equal(2, stats.histogram[2]);
+            assert_equal(1, stats.histogram[3]);
+        }
+
+        it("records laps") {
+            stimer_stats_reset(&stats);
+            stimer_start(t1);
+            assert_equal(0, stimer_lap(t1));
+            current_time += 5;
+            assert_equal(5, stimer_lap(t1));
+            current_time += 7;
+            assert_equal(7, stimer_lap(t1));
+            stimer_stop(t1);
+
+            assert_equal(4, stats.count);
+            assert_equal(12, stats.total_ticks);
+            assert_equal(0, stats.min_ticks);
+            assert_equal(7, stats.max_ticks);
+            assert_equal(2, stats.histogram[0]);
+        }
+
+        it("keeps the deviation of large samples") {
+            // Long periods with a small spread, whose squares do not fit
+            uint64_t base = (uint64_t) 1 << 33;
+            stimer_stats_reset(&stats);
+            stimer_stats_add(&stats, base - 2);
+            stimer_stats_add(&stats, base + 2);
+            stimer_stats_add(&stats, base - 2);
+            stimer_stats_add(&stats, base + 2);
+
+            assert_equal(false, stats.is_saturated);
+            assert_equal(base, stimer_stats_get_mean_ticks(&stats));
+            assert_equal(2, stimer_stats_get_stddev_ticks(&stats));
+        }
+
+        it("keeps the deviation of many samples with a wide spread") {
+            // 1 ms of jitter in nanosecond ticks
+            uint64_t base = 1000000000u;
+            uint64_t spread = 1000000u;
+            uint32_t i;
+            stimer_stats_reset(&stats);
+            for (i = 0; i < 100000u; ++i) {
+                stimer_stats_add(&stats, ((i % 2) == 0) ? (base - spread) : (base + spread));
+            }
+
+            assert_equal(false, stats.is_saturated);
+            assert_equal(base, stimer_stats_get_mean_ticks(&stats));
+            assert_equal(spread, stimer_stats_get_stddev_ticks(&stats));
+        }
+
+        it("saturates once count times variance passes 2^64") {
+            // A variance of 2^56 ticks squared fits 256 samples
+            uint64_t base = (uint64_t) 1 << 40;
+            uint64_t spread = (uint64_t) 1 << 28;
+            uint32_t i;
+            stimer_stats_reset(&stats);
+            for (i = 0; i < 250u; ++i) {
+                stimer_stats_add(&stats, ((i % 2) == 0) ? (base - spread) : (base + spread));
+            }
+            // Deviations this large are summed in whole ticks only
+            uint64_t stddev = stimer_stats_get_stddev_ticks(&stats);
+            assert_equal(false, stats.is_saturated);
+            assert_equal(true, (stddev >= (spread - 1)) && (stddev <= spread));
+
+            for (; i < 260u; ++i) {
+                stimer_stats_add(&stats, ((i % 2) == 0) ? (base - spread) : (base + spread));
+            }
+            assert_equal(true, stats.is_saturated);
+            assert_equal(UINT64_MAX, stimer_stats_get_stddev_ticks(&stats));
+        }
+
+        it("saturates the deviation of a huge spread") {
+            stimer_stats_reset(&stats);
+            stimer_stats_add(&stats, 0);
+            stimer_stats_add(&stats, (uint64_t) 1 << 40);
+
+            assert_equal(true, stats.is_saturated);
+            assert_equal(UINT64_MAX, stimer_stats_get_stddev_ticks(&stats));
+
+            stimer_stats_reset(&stats);
+            assert_equal(false, stats.is_saturated);
+            assert_equal(0, stimer_stats_get_stddev_ticks(&stats));
+        }
+
+        it("does not lap a timer set to expire") {
+            stimer_expire_from_now_ms(t1, 10);
+            current_time += 5;
+            assert_equal(0, stimer_lap(t1));
+            assert_equal(5, stimer_get_elapsed_ticks(t1));
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free(t1);
+            stimer_free_context(ctx);
+        }
+    }
+
+    describe("Timer jitter") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+        struct stimer_stats jitter;
+
+        struct stimer * t1 = NULL;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            t1 = stimer_alloc(ctx);
+            assert_not_null(t1);
+
+            stimer_stats_reset(&jitter);
+            assert_equal(true, stimer_set_jitter_stats(t1, &jitter));
+        }
+
+        it("records the lateness of each advance") {
+            stimer_expire_from_now_ms(t1, 10);
+
+            uint32_t ideal = 0;
+            uint32_t i;
+            for (i = 0; i < 4; ++i) {
+                ideal += 10;
+                current_time = (ideal + (((i % 2) == 0) ? 2 : 6)) & 0xFF;
+                assert_equal(true, stimer_is_expired(t1));
+                stimer_advance(t1);
+            }
+
+            assert_equal(4, jitter.count);
+            assert_equal(2, jitter.min_ticks);
+            assert_equal(6, jitter.max_ticks);
+            assert_equal(4, stimer_stats_get_mean_ticks(&jitter));
+            assert_equal(2, stimer_stats_get_stddev_ticks(&jitter));
+            assert_equal(2, jitter.histogram[2]);
+            assert_equal(2, jitter.histogram[3]);
+        }
+
+        it("does not record an advance before expiration") {
+            current_time = 41;
+            assert_equal(false, stimer_is_expired(t1));
+            stimer_advance(t1);
+            assert_equal(4, jitter.count);
+        }
+
+        it("does not record elapsed times") {
+            stimer_stop(t1);
+            assert_equal(4, jitter.count);
+        }
+
+        it("is replaced by elapsed time statistics") {
+            assert_equal(true, stimer_set_stats(t1, &jitter));
+            stimer_expire_from_now_ms(t1, 10);
+            current_time += 12;
+            stimer_advance(t1);
+            assert_equal(4, jitter.count);
+            stimer_stop(t1);
+            assert_equal(5, jitter.count);
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free(t1);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_CALENDAR
+    describe("Calendar queue") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+
+        struct stimer * timers[100];
+        int i;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFFFF, 1000000);
+            assert_not_null(ctx);
+
+            for (i = 0; i < 100; ++i) {
+                timers[i] = stimer_alloc(ctx);
+                assert_not_null(timers[i]);
+            }
+            assert_equal(STIMER_CONFIG_CALENDAR_MIN_BUCKETS, ctx->index.bucket_count);
+        }
+
+        it("finds deadlines beyond one calendar year") {
+            // One day per tick, so a year is as many ticks as there are
+            // buckets. Both timers share a bucket
+            uint32_t year = ctx->index.bucket_count;
+            stimer_expire_from_now_ms(timers[0], 5);
+            stimer_expire_from_now_ms(timers[1], 5 + (10 * year));
+            stimer_expire_from_now_ms(timers[2], 1000);
+            assert_equal(0, ctx->index.width_shift);
+            assert_equal(5, stimer_get_ticks_until_next(ctx));
+
+            current_time = 5;
+            stimer_execute_context(ctx);
+            assert_equal(true, stimer_is_expired(timers[0]));
+            assert_equal(10 * year, stimer_get_ticks_until_next(ctx));
+
+            current_time = 4 + (10 * year);
+            stimer_execute_context(ctx);
+            assert_equal(false, stimer_is_expired(timers[1]));
+
+            current_time = 5 + (10 * year);
+            stimer_execute_context(ctx);
+            assert_equal(true, stimer_is_expired(timers[1]));
+            assert_equal(995 - (10 * year), stimer_get_ticks_until_next(ctx));
+
+            current_time = 1000;
+            stimer_execute_context(ctx);
+            assert_equal(true, stimer_is_expired(timers[2]));
+            assert_equal(0x3FFF, stimer_get_ticks_until_next(ctx));
+        }
+
+        it("grows its buckets and sizes its days to the timer spacing") {
+            for (i = 0; i < 100; ++i) {
+                stimer_expire_from_now_ms(timers[i], 3 * (i + 1));
+            }
+            assert_equal(100, ctx->index.size);
+            assert_equal(64, ctx->index.bucket_count);
+
+            // A few times the 3 tick spacing
+            uint32_t width = 1u << ctx->index.width_shift;
+            assert_equal(true, (width >= 6) && (width <= 12));
+        }
+
+        it("expires timers in order across resizes") {
+            for (i = 0; i < 100; ++i) {
+                assert_equal(3, stimer_get_ticks_until_next(ctx));
+                current_time += 3;
+                stimer_execute_context(ctx);
+                assert_equal(true, stimer_is_expired(timers[i]));
+                if (i < 99) {
+                    assert_equal(false, stimer_is_expired(timers[i + 1]));
+                }
+            }
+            assert_equal(0, ctx->index.size);
+            assert_equal(STIMER_CONFIG_CALENDAR_MIN_BUCKETS, ctx->index.bucket_count);
+        }
+
+        it("shrinks its buckets as timers are stopped") {
+            for (i = 0; i < 100; ++i) {
+                stimer_expire_from_now_ms(timers[i], 1 + i);
+            }
+            for (i = 0; i < 80; ++i) {
+                stimer_stop(timers[i]);
+            }
+            assert_equal(20, ctx->index.size);
+            assert_equal(32, ctx->index.bucket_count);
+            assert_equal(81, stimer_get_ticks_until_next(ctx));
+        }
+
+        it("test objects can be deallocated") {
+            for (i = 0; i < 100; ++i) {
+                stimer_free(timers[i]);
+            }
+            stimer_free_context(ctx);
+        }
+    }
+#endif
+
+
+#if STIMER_CONFIG_BACKEND == STIMER_BACKEND_RADIX
+    describe("Radix heap") {
+        struct stimer_ctx * ctx = NULL;
+        uint32_t current_time = 0;
+
+        struct stimer * timers[50];
+        int i;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFFFF, 1000000);
+            assert_not_null(ctx);
+
+            for (i = 0; i < 50; ++i) {
+                timers[i] = stimer_alloc(ctx);
+                assert_not_null(timers[i]);
+            }
+        }
+
+        it("pops equal deadlines from the head of bucket 0") {
+            for (i = 0; i < 50; ++i) {
+                stimer_expire_from_now_ms(timers[i], 10);
+            }
+
+            current_time = 10;
+            assert_equal(false, stimer_execute_context_budget(ctx, 1));
+            assert_equal(10, ctx->index.last);
+            assert_equal(0, ctx->index.occupied);
+            assert_not_null(ctx->index.buckets[0]);
+
+            for (i = 0; i < 48; ++i) {
+                assert_equal(false, stimer_execute_context_budget(ctx, 1));
+                assert_equal(ctx->index.buckets[0], ctx->index.min);
+            }
+            assert_equal(true, stimer_execute_context_budget(ctx, 1));
+            assert_null(ctx->index.buckets[0]);
+
+            for (i = 0; i < 50; ++i) {
+                assert_equal(true, stimer_is_expired(timers[i]));
+            }
+        }
+
+        it("test objects can be deallocated") {
+            for (i = 0; i < 50; ++i) {
+                stimer_free(timers[i]);
+            }
+            stimer_free_context(ctx);
+        }
+    }
+#endif
+
     return 0;
 }
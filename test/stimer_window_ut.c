@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2016 Bradley Kim Schleusner < bradschl@gmail.com >
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "describe/describe.h"
+
+#include "stimer/stimer_window.h"
+
+
+static uint32_t
+mock_get_time(void * hint)
+{
+    uint32_t t = 0;
+    if(NULL != hint) {
+        t = *((uint32_t *) hint);
+    }
+    return t;
+}
+
+
+int main(int argc, char const *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    describe("Sliding window counter") {
+        struct stimer_ctx * ctx = NULL;
+        struct stimer_window * window = NULL;
+        uint32_t current_time = 0;
+
+        it("test objects can be allocated") {
+            ctx = stimer_alloc_context(&current_time, mock_get_time, 0xFF, 1000000);
+            assert_not_null(ctx);
+
+            // 4 buckets of 10ms, a 40ms window
+            struct stimer_duration width = { 0, 10000000 };
+            window = stimer_alloc_window(ctx, 4, &width);
+            assert_not_null(window);
+
+            assert_null(stimer_alloc_window(ctx, 0, &width));
+        }
+
+        it("counts events in the window") {
+            stimer_window_add(window, 1);
+            current_time = 9;
+            stimer_window_add(window, 2);
+            current_time = 15;
+            stimer_window_add(window, 3);
+            current_time = 39;
+            stimer_window_add(window, 4);
+
+            assert_equal(10, stimer_window_get_count(window));
+            assert_equal(250, stimer_window_get_rate_per_s(window));
+        }
+
+        it("drops buckets as they leave the window") {
+            current_time = 40;
+            assert_equal(7, stimer_window_get_count(window));
+            current_time = 50;
+            assert_equal(4, stimer_window_get_count(window));
+            current_time = 69;
+            assert_equal(4, stimer_window_get_count(window));
+            current_time = 70;
+            assert_equal(0, stimer_window_get_count(window));
+        }
+
+        it("drops everything after a long idle time") {
+            stimer_window_add(window, 5);
+
+            uint32_t i;
+            for (i = 0; i < 1000; ++i) {
+                current_time = (current_time + 1) & 0xFF;
+                (void) stimer_get_context_ticks(ctx);
+            }
+            assert_equal(0, stimer_window_get_count(window));
+
+            stimer_window_add(window, 6);
+            assert_equal(6, stimer_window_get_count(window));
+        }
+
+        it("can be reset") {
+            stimer_window_reset(window);
+            assert_equal(0, stimer_window_get_count(window));
+        }
+
+        it("test objects can be deallocated") {
+            stimer_free_window(window);
+            stimer_free_context(ctx);
+        }
+    }
+
+
+    return 0;
+}